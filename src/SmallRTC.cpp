@@ -63,6 +63,17 @@
  *                                   Cleaned up drift management code.
  *                                   Drift now requires it to be unpaused.
  * Version 2.4.7 January   23, 2026 : Fixed New Minute variable, wrong type.
+ * Version 2.4.8 October   18, 2026 : Added RV-3028, RV-8803, PCF85063 and
+ *                                   DS1307 through register maps.
+ *                                   Added more than one instance, async jobs,
+ *                                   maintenance mode and snapshots.
+ *                                   Added second and countdown wakes, wake
+ *                                   boundaries, time sources with sync, bus
+ *                                   failover, event log and slewed drift.
+ *                                   Added calibrated slow clock sleeps, charge
+ *                                   estimates, monotonicMicros, cached battery
+ *                                   and temperature, batch time conversions.
+ *                                   Added the test/ simulator.
  *
  * This library offers an alternative to the WatchyRTC library, but also
  * provides a 100% time.h and timelib.h compliant RTC library.
@@ -95,62 +106,233 @@
 
 RTC_DATA_ATTR __srtcsto _ssrtc;
 
-SmallRTC::SmallRTC () {}
+#define RTC_OP_READ 1
+#define RTC_OP_SET 2
+#define RTC_OP_WAKE 3
+
+static QueueHandle_t _srtcqueue = NULL; // Jobs waiting for the worker task.
+static volatile uint8_t _srtcworker = 0; // 0 none, 1 starting, 2 running.
+static SemaphoreHandle_t _srtclock = NULL; // Bus and state, see _srtcguard.
+static SmallRTC *volatile _srtcowner = NULL; // Maintenance mode instance.
+static volatile uint32_t _srtcinterval = 60000;
+static portMUX_TYPE _srtcmonomux = portMUX_INITIALIZER_UNLOCKED;
+// RTC timer value the armed deep sleep timer wake is for, 0 for none.  Not
+// kept in RTC memory as wake sources don't survive a boot either.
+static uint64_t _srtctimerat = 0;
+
+// Held by the public calls, so the worker task and the foreground never use
+// the bus or a state block at the same time.  The lock is made by the first
+// SmallRTC constructed, before either can start.
+class _srtcguard
+{
+public:
+  _srtcguard () : _held (_srtclock != NULL)
+  {
+    if (_held)
+      {
+        xSemaphoreTakeRecursive (_srtclock, portMAX_DELAY);
+      }
+  }
+  ~_srtcguard ()
+  {
+    if (_held)
+      {
+        xSemaphoreGiveRecursive (_srtclock);
+      }
+  }
+
+private:
+  bool _held;
+};
+
+// Register maps, DS3231 and PCF8563 are here for RTCs not on Wire.
+static const srtcchip _srtcchips[] = {
+  { RTC_DS3231, RTC_DS_ADDR, 0x00, RTC_LAYOUT_WDAY1, 0x0F, 0x80, 0x0B, 3,
+    0x0E, 0x02, 0x0F, 0x02, 0x10, 0xFF },
+  { RTC_PCF8563, RTC_PCF_ADDR, 0x02, RTC_LAYOUT_DATEFIRST, 0x02, 0x80, 0x09,
+    4, 0x01, 0x02, 0x01, 0x08, 0x00, 0x00 },
+  { RTC_RV3028, 0x52, 0x00, RTC_LAYOUT_PROBE, 0x0E, 0x01, 0x07, 3, 0x10,
+    0x08, 0x0E, 0x04, 0x36, 0xFF },
+  { RTC_RV8803, 0x32, 0x00, RTC_LAYOUT_WDAYBIT | RTC_LAYOUT_PROBE, 0x0E, 0x02,
+    0x08, 3, 0x0F, 0x08, 0x0E, 0x08, 0x2C, 0x3F },
+  { RTC_PCF85063, RTC_PCF_ADDR, 0x04, RTC_LAYOUT_DATEFIRST, 0x04, 0x80, 0x0C,
+    4, 0x01, 0x80, 0x01, 0x40, 0x02, 0x7F },
+  { RTC_DS1307, RTC_DS_ADDR, 0x00, RTC_LAYOUT_WDAY1, 0x00, 0x80, 0x00, 0,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+};
+
+// Typical figures per RTC type (not per board), the ESP32's deep sleep (about
+// 10uA with the RTC timer) plus the RTC's own supply current.  The last
+// entry is used for anything not listed.
+static const srtcenergy _srtcenergies[] = {
+  { RTC_DS3231, 120.0, 0.03, 0.06, 0.0 },
+  { RTC_PCF8563, 10.3, 0.03, 0.06, 0.0 },
+  { RTC_RV3028, 10.1, 0.03, 0.06, 0.0 },
+  { RTC_RV8803, 10.3, 0.03, 0.06, 0.0 },
+  { RTC_PCF85063, 10.3, 0.03, 0.06, 0.0 },
+  { RTC_DS1307, 210.0, 0.03, 0.06, 0.0 },
+  { RTC_ESP32, 10.0, 0.03, 0.06, 0.0 },
+};
+
+static uint8_t
+_srtcbcd (uint8_t v)
+{
+  return ((v / 10) << 4) | (v % 10);
+}
+
+static uint8_t
+_srtcdec (uint8_t v)
+{
+  return ((v >> 4) * 10) + (v & 0x0F);
+}
+
+static int64_t
+_srtcnowus ()
+{
+  struct timeval t;
+  gettimeofday (&t, NULL);
+  return (int64_t)t.tv_sec * 1000000LL + t.tv_usec;
+}
+
+// NTP timestamps are seconds since 1900 with a 32 bit fraction, values below
+// 2^31 are taken as past the 2036 rollover.
+static int64_t
+_srtcntpget (const uint8_t *b)
+{
+  int64_t s = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16)
+              | ((uint32_t)b[2] << 8) | b[3];
+  uint64_t f = ((uint32_t)b[4] << 24) | ((uint32_t)b[5] << 16)
+               | ((uint32_t)b[6] << 8) | b[7];
+  if (s < 0x80000000LL)
+    {
+      s += 0x100000000LL;
+    }
+  return (s - 2208988800LL) * 1000000LL + (int64_t)((f * 1000000ULL) >> 32);
+}
+
+static void
+_srtcntpput (uint8_t *b, int64_t us)
+{
+  uint32_t s = (uint32_t)(us / 1000000LL + 2208988800LL);
+  uint32_t f = (uint32_t)((((uint64_t)(us % 1000000LL) << 32) + 999999ULL)
+                          / 1000000ULL);
+  for (uint8_t i = 0; i < 4; i++)
+    {
+      b[i] = s >> (24 - i * 8);
+      b[i + 4] = f >> (24 - i * 8);
+    }
+}
+
+SmallRTC::SmallRTC () : SmallRTC (_ssrtc, Wire, 0) {}
+
+SmallRTC::SmallRTC (__srtcsto &store, TwoWire &wire, uint8_t address)
+{
+  _sto = &store;
+  _wire = &wire;
+  _addr = address;
+  _seq = 0;
+  _snap = {};
+  portMUX_INITIALIZE (&_snapmux);
+  if (_srtclock == NULL)
+    {
+      _srtclock = xSemaphoreCreateRecursiveMutex ();
+    }
+}
 
 void
 SmallRTC::init ()
+{
+  SmallRTC::init (RTC_UNKNOWN);
+}
+
+void
+SmallRTC::init (uint8_t rtctype)
 {
   uint8_t controlReg, mask;
   log_d ("SmallRTC:  Init Started.");
-  _ssrtc.m_rtctype = RTC_UNKNOWN;
-  _ssrtc.m_adc_pin = 0;
-  _ssrtc.m_rtc_pin = 0;
-  _ssrtc.f_watchyhwver = 0;
-  _ssrtc.b_limitUnder = false;
-  _ssrtc.srtcdrift.esprtc.drift = 0;
-  _ssrtc.srtcdrift.extrtc.drift = 0;
-  _ssrtc.srtcdrift.esprtc.begin = 0;
-  _ssrtc.srtcdrift.extrtc.begin = 0;
-  _ssrtc.srtcdrift.esprtc.slush = 0;
-  _ssrtc.srtcdrift.extrtc.slush = 0;
-  _ssrtc.srtcdrift.esprtc.fast = false;
-  _ssrtc.srtcdrift.extrtc.fast = false;
-  _ssrtc.srtcdrift.paused = true;
+  _sto->m_rtctype = RTC_UNKNOWN;
+  _sto->m_adc_pin = 0;
+  _sto->m_rtc_pin = 0;
+  _sto->f_watchyhwver = 0;
+  _sto->b_limitUnder = false;
+  _sto->srtcdrift.esprtc.drift = 0;
+  _sto->srtcdrift.extrtc.drift = 0;
+  _sto->srtcdrift.esprtc.begin = 0;
+  _sto->srtcdrift.extrtc.begin = 0;
+  _sto->srtcdrift.esprtc.slush = 0;
+  _sto->srtcdrift.extrtc.slush = 0;
+  _sto->srtcdrift.esprtc.fast = false;
+  _sto->srtcdrift.extrtc.fast = false;
+  _sto->srtcdrift.paused = true;
+  _sto->m_slowcal = 0;
+  _sto->f_battery = 0;
+  _sto->m_batwakes = 0;
+  _sto->m_tempstamp = 0;
+  _sto->b_slew = false;
+  _sto->m_slew = 0;
+  _sto->srtctimer.start = 0;
+  _sto->srtctimer.length = 0;
+  _sto->m_boundary = RTC_WAKE_MINUTE;
+  _sto->b_failover = false;
+  SmallRTC::clearEvents ();
+  SmallRTC::clearCharge ();
+  if (!_sto->m_sda && !_sto->m_scl)
+    { // Other buses need setBusPins for recovery.
+      _sto->m_sda = (_wire == &Wire ? SDA : -1);
+      _sto->m_scl = (_wire == &Wire ? SCL : -1);
+    }
   sysBoot ();
 #ifndef SMALL_RTC_NO_INT
   esp_chip_info_t chip_info[sizeof (esp_chip_info_t)];
   esp_chip_info (chip_info);
-  if (chip_info->model == CHIP_ESP32S3)
+  if (rtctype > RTC_ESP32)
     {
-      _ssrtc.m_rtctype = RTC_ESP32;
-      _ssrtc.b_operational = true;
-      _ssrtc.m_adc_pin = 9;
-      _ssrtc.f_watchyhwver = 3.0;
-      _ssrtc.b_use32K = true;
+      SmallRTC::_chipInit (rtctype);
     }
-  else if (chip_info->model == CHIP_ESP32C6)
+  else if (chip_info->model == CHIP_ESP32S3 && !_addr && _wire == &Wire)
     {
-      _ssrtc.m_rtctype = RTC_ESP32;
-      _ssrtc.b_operational = true;
-      _ssrtc.m_adc_pin = 0;
-      _ssrtc.f_watchyhwver = 0.0;
-      _ssrtc.b_use32K = true;
+      _sto->m_rtctype = RTC_ESP32;
+      _sto->b_operational = true;
+      _sto->m_adc_pin = 9;
+      _sto->f_watchyhwver = 3.0;
+      _sto->b_use32K = true;
+    }
+  else if (chip_info->model == CHIP_ESP32C6 && !_addr && _wire == &Wire)
+    {
+      _sto->m_rtctype = RTC_ESP32;
+      _sto->b_operational = true;
+      _sto->m_adc_pin = 0;
+      _sto->f_watchyhwver = 0.0;
+      _sto->b_use32K = true;
     }
   else
     {
 #else
-  if (1)
+  if (rtctype > RTC_ESP32)
+    {
+      SmallRTC::_chipInit (rtctype);
+    }
+  else
     {
 #endif
-      Wire.begin ();
+      if (_wire == &Wire)
+        {
+          Wire.begin ();
+        }
 #ifndef SMALL_RTC_NO_DS3232
-      Wire.beginTransmission (RTC_DS_ADDR);
-      if (!Wire.endTransmission ())
+      if ((!_addr || _addr == RTC_DS_ADDR) && SmallRTC::_busAck (RTC_DS_ADDR))
+        {
+          _sto->m_rtctype = RTC_DS3231;
+          _sto->m_adc_pin = 33;
+          _sto->m_rtc_pin = 27;
+          _sto->f_watchyhwver = 1.0;
+        }
+      if (_sto->m_rtctype == RTC_DS3231 && _wire != &Wire)
+        {
+          SmallRTC::_chipInit (RTC_DS3231);
+        }
+      else if (_sto->m_rtctype == RTC_DS3231)
         {
-          _ssrtc.m_rtctype = RTC_DS3231;
-          _ssrtc.m_adc_pin = 33;
-          _ssrtc.m_rtc_pin = 27;
-          _ssrtc.f_watchyhwver = 1.0;
           controlReg = rtc_ds.readRTC (0x0E);
           mask = _BV (7);
           if (controlReg & mask)
@@ -158,8 +340,8 @@ SmallRTC::init ()
               controlReg &= ~mask;
               rtc_ds.writeRTC (0x0E, controlReg);
             }
-          _ssrtc.b_operational = true;
-          checkStatus (_ssrtc.b_operational);
+          _sto->b_operational = true;
+          checkStatus (_sto->b_operational);
           rtc_ds.squareWave (DS3232RTC::SQWAVE_NONE);
           rtc_ds.alarm (DS3232RTC::ALARM_2);
           rtc_ds.setAlarm (DS3232RTC::ALM2_EVERY_MINUTE, 0, 0, 0, 0);
@@ -169,90 +351,91 @@ SmallRTC::init ()
         {
 #endif
 #ifndef SMALL_RTC_NO_PCF8563
-          Wire.beginTransmission (RTC_PCF_ADDR);
-          if (!Wire.endTransmission ())
+          if ((!_addr || _addr == RTC_PCF_ADDR)
+              && SmallRTC::_busAck (RTC_PCF_ADDR))
             {
-              _ssrtc.m_rtctype = RTC_PCF8563;
-              _ssrtc.m_rtc_pin = 27;
-              _ssrtc.b_operational = true;
-              rtc_pcf.clearStatus ();
-              Wire.beginTransmission (0xa3 >> 1);
-              Wire.write (0x09);
-              Wire.write (0x80);
-              Wire.write (0x80);
-              Wire.write (0x80);
-              Wire.write (0x80);
-              Wire.write (0x0);
-              Wire.write (0x0);
-              Wire.endTransmission ();
+              _sto->m_rtctype = RTC_PCF8563;
+              _sto->m_rtc_pin = 27;
+              _sto->b_operational = true;
+              uint8_t c[] = { 0x0, 0x0 };
+              uint8_t a[] = { 0x80, 0x80, 0x80, 0x80, 0x0, 0x0 };
+              SmallRTC::_writeRegs (0x00, c, 2); // Status cleared.
+              SmallRTC::_writeRegs (0x09, a, 6);
               if ((analogReadMilliVolts (34) / 500.0f) > 2)
                 {
-                  _ssrtc.m_adc_pin = 34;
-                  _ssrtc.f_watchyhwver = 2.0;
+                  _sto->m_adc_pin = 34;
+                  _sto->f_watchyhwver = 2.0;
                 } // Find the battery to determine hardware
                   // version.
               if ((analogReadMilliVolts (35) / 500.0f) > 2)
                 {
-                  _ssrtc.m_adc_pin = 35;
-                  _ssrtc.f_watchyhwver = 1.5;
+                  _sto->m_adc_pin = 35;
+                  _sto->f_watchyhwver = 1.5;
                 }
             }
 #endif
 #ifndef SMALL_RTC_NO_DS3232
         }
 #endif
+      if (_sto->m_rtctype == RTC_UNKNOWN)
+        {
+          SmallRTC::_chipProbe ();
+        }
     }
-  if (!_ssrtc.f_watchyhwver)
+  if (!_sto->f_watchyhwver)
     { /* Try to find it by way of battery */
 #ifndef SMALL_RTC_NO_DS3232
       if ((analogReadMilliVolts (33) / 500.0f) > 2)
         {
-          _ssrtc.m_adc_pin = 33;
-          _ssrtc.m_rtc_pin = 27;
-          _ssrtc.f_watchyhwver = 1.0;
+          _sto->m_adc_pin = 33;
+          _sto->m_rtc_pin = 27;
+          _sto->f_watchyhwver = 1.0;
         }
 #endif
 #ifndef SMALL_RTC_NO_PCF8563
       if ((analogReadMilliVolts (34) / 500.0f) > 2)
         {
-          _ssrtc.m_adc_pin = 34;
-          _ssrtc.m_rtc_pin = 27;
-          _ssrtc.f_watchyhwver = 2.0;
+          _sto->m_adc_pin = 34;
+          _sto->m_rtc_pin = 27;
+          _sto->f_watchyhwver = 2.0;
         }
       if ((analogReadMilliVolts (35) / 500.0f) > 2)
         {
-          _ssrtc.m_adc_pin = 35;
-          _ssrtc.m_rtc_pin = 27;
-          _ssrtc.f_watchyhwver = 1.5;
+          _sto->m_adc_pin = 35;
+          _sto->m_rtc_pin = 27;
+          _sto->f_watchyhwver = 1.5;
         }
 #endif
-      if (!_ssrtc.f_watchyhwver && _ssrtc.m_rtctype != RTC_ESP32)
+      if (!_sto->f_watchyhwver && _sto->m_rtctype != RTC_ESP32
+          && (_sto->m_rtctype == RTC_UNKNOWN || !SmallRTC::_generic ()))
         {
-          _ssrtc.b_forceesp32 = true;
+          _sto->b_forceesp32 = true;
         }
-      if (_ssrtc.b_use32K)
+      if (_sto->b_use32K)
         {
-          rtc_clk_32k_enable (_ssrtc.b_use32K);
-          _ssrtc.b_use32K = rtc_clk_32k_enabled ();
-          if (!_ssrtc.b_use32K)
+          rtc_clk_32k_enable (_sto->b_use32K);
+          _sto->b_use32K = rtc_clk_32k_enabled ();
+          if (!_sto->b_use32K)
             {
-              _ssrtc.b_limitUnder = true;
+              _sto->b_limitUnder = true;
               log_w ("SmallRTC:  32k XTAL is not initialized.");
             }
         }
     }
+  SmallRTC::_logEvent (RTC_EVT_INIT);
   log_d ("SmallRTC:  Init Completed.");
 }
 
 void
 SmallRTC::sysBoot ()
 {
-   _ssrtc.srtcdrift.newlasthr = 25;
+   _sto->srtcdrift.newlasthr = 25;
 }
 
 void
 SmallRTC::setDateTime (String datetime)
 {
+  _srtcguard lock;
   tmElements_t tm, tst;
   uint8_t controlReg, mask;
   tm.Year = CalendarYrToTm (_getValue (datetime, ':', 0).toInt ());
@@ -261,6 +444,15 @@ SmallRTC::setDateTime (String datetime)
   tm.Hour = _getValue (datetime, ':', 3).toInt ();
   tm.Minute = _getValue (datetime, ':', 4).toInt ();
   tm.Second = _getValue (datetime, ':', 5).toInt ();
+  if (SmallRTC::_generic ())
+    {
+      time_t g;
+      tm.Month--;
+      g = SmallRTC::doMakeTime (tm);
+      SmallRTC::doBreakTime (g, tm); // Wday isn't in the string.
+      SmallRTC::set (tm);
+      return;
+    }
 #ifndef SMALL_RTC_NO_INT
   time_t t = SmallRTC::doMakeTime (tm);
   SmallRTC::doBreakTime (t, tm);
@@ -269,8 +461,9 @@ SmallRTC::setDateTime (String datetime)
   clock_settime (CLOCK_REALTIME, &tv);
   SmallRTC::driftReset (t, true);
 #endif
+  _sto->m_slew = 0;
 #ifndef SMALL_RTC_NO_DS3232
-  if (_ssrtc.m_rtctype == RTC_DS3231)
+  if (_sto->m_rtctype == RTC_DS3231)
     {
       tm.Wday++;
       rtc_ds.write (tm);
@@ -284,11 +477,12 @@ SmallRTC::setDateTime (String datetime)
         }
       checkStatus ();
       rtc_ds.read (tst);
+      SmallRTC::_busCount (20);
     }
 
 #endif
 #ifndef SMALL_RTC_NO_PCF8563
-  if (_ssrtc.m_rtctype == RTC_PCF8563)
+  if (_sto->m_rtctype == RTC_PCF8563)
     {
       rtc_pcf.setDate (tm.Day, tm.Wday, tm.Month, 0, tm.Year);
       rtc_pcf.setTime (tm.Hour, tm.Minute, tm.Second);
@@ -298,12 +492,13 @@ SmallRTC::setDateTime (String datetime)
       tst.Day = rtc_pcf.getDay ();
       tst.Hour = rtc_pcf.getHour ();
       tst.Minute = rtc_pcf.getMinute ();
+      SmallRTC::_busCount (26);
       SmallRTC::driftReset (t, false);
       SmallRTC::setnewmin (tm.Hour, tm.Minute, tm.Second);
     }
-  if (_ssrtc.b_operational)
+  if (_sto->b_operational)
     {
-      _ssrtc.b_operational
+      _sto->b_operational
           = (tm.Year == tst.Year && tm.Month == tst.Month && tm.Day == tst.Day
              && tm.Hour == tst.Hour && tm.Minute == tst.Minute);
     }
@@ -313,73 +508,94 @@ SmallRTC::setDateTime (String datetime)
 void
 SmallRTC::read (tmElements_t &p_tmoutput)
 {
-
+  _srtcguard lock;
   SmallRTC::read (p_tmoutput, false);
+  SmallRTC::_publish (p_tmoutput);
 }
 
 void
 SmallRTC::read (tmElements_t &p_tmoutput, bool internal)
 {
+  bool ok = SmallRTC::_busCheck ();
 #ifndef SMALL_RTC_NO_INT
   tmElements_t ti;
   clock_gettime (CLOCK_REALTIME, &tv);
   SmallRTC::doBreakTime (tv.tv_sec, ti);
-  checkStatus ();
-  if (_ssrtc.m_rtctype == RTC_ESP32 || _ssrtc.b_forceesp32 || internal)
+  if (ok)
+    {
+      checkStatus ();
+    }
+  if (_sto->m_rtctype == RTC_ESP32 || _sto->b_forceesp32 || internal || !ok)
     {
       SmallRTC::setnewmin (ti.Hour, ti.Minute, ti.Second);
-      _ssrtc.srtcdrift.esprtc.drifted = false;
+      _sto->srtcdrift.esprtc.drifted = false;
       SmallRTC::manageDrift (ti, true);
       p_tmoutput = ti;
     }
 #endif
-#ifndef SMALL_RTC_NO_DS3232
-  if (_ssrtc.m_rtctype == RTC_DS3231)
+  if (ok
+      && (_sto->m_rtctype == RTC_DS3231 || _sto->m_rtctype == RTC_PCF8563
+          || _sto->m_rtctype > RTC_ESP32))
     {
-      rtc_ds.read (p_tmoutput);
-      SmallRTC::setnewmin (p_tmoutput.Hour, p_tmoutput.Minute, p_tmoutput.Second);
-      p_tmoutput.Wday--;
-      p_tmoutput.Month--;
-      tv.tv_nsec = 0;
-      tv.tv_sec = SmallRTC::doMakeTime (ti);
-      clock_settime (CLOCK_REALTIME, &tv);
-      _ssrtc.srtcdrift.extrtc.drifted = false;
-      SmallRTC::manageDrift (ti, true);
-      SmallRTC::manageDrift (p_tmoutput, false);
-    }
+      if (SmallRTC::_generic ())
+        {
+          SmallRTC::_busRead (p_tmoutput);
+        }
+#ifndef SMALL_RTC_NO_DS3232
+      else if (_sto->m_rtctype == RTC_DS3231)
+        {
+          rtc_ds.read (p_tmoutput);
+          SmallRTC::_busCount (8);
+          p_tmoutput.Wday--;
+          p_tmoutput.Month--;
+        }
 #endif
 #ifndef SMALL_RTC_NO_PCF8563
-  if (_ssrtc.m_rtctype == RTC_PCF8563)
-    {
-      p_tmoutput.Year = rtc_pcf.getYear ();
-      p_tmoutput.Month = rtc_pcf.getMonth () - 1;
-      p_tmoutput.Day = rtc_pcf.getDay ();
-      p_tmoutput.Wday = rtc_pcf.getWeekday ();
-      p_tmoutput.Hour = rtc_pcf.getHour ();
-      p_tmoutput.Minute = rtc_pcf.getMinute ();
-      p_tmoutput.Second = rtc_pcf.getSecond ();
+      else if (_sto->m_rtctype == RTC_PCF8563)
+        {
+          p_tmoutput.Year = rtc_pcf.getYear ();
+          p_tmoutput.Month = rtc_pcf.getMonth () - 1;
+          p_tmoutput.Day = rtc_pcf.getDay ();
+          p_tmoutput.Wday = rtc_pcf.getWeekday ();
+          p_tmoutput.Hour = rtc_pcf.getHour ();
+          p_tmoutput.Minute = rtc_pcf.getMinute ();
+          p_tmoutput.Second = rtc_pcf.getSecond ();
+          SmallRTC::_busCount (14);
+        }
+#endif
+      if (_sto->m_slew)
+        { // Slewed drift that hasn't been written to the RTC yet.
+          tv.tv_sec = SmallRTC::doMakeTime (p_tmoutput) + _sto->m_slew;
+          SmallRTC::doBreakTime (tv.tv_sec, p_tmoutput);
+        }
       SmallRTC::setnewmin (p_tmoutput.Hour, p_tmoutput.Minute, p_tmoutput.Second);
-      tv.tv_nsec = 0;
-      tv.tv_sec = SmallRTC::doMakeTime (ti);
-      clock_settime (CLOCK_REALTIME, &tv);
-      _ssrtc.srtcdrift.extrtc.drifted = false;
-      SmallRTC::manageDrift (ti, true);
+#ifndef SMALL_RTC_NO_INT
+      if (_sto == &_ssrtc)
+        { // The ESP32's clock is shared, only the default instance keeps it.
+          tv.tv_nsec = 0;
+          tv.tv_sec = SmallRTC::doMakeTime (ti);
+          clock_settime (CLOCK_REALTIME, &tv);
+          SmallRTC::manageDrift (ti, true);
+        }
+#endif
+      _sto->srtcdrift.extrtc.drifted = false;
       SmallRTC::manageDrift (p_tmoutput, false);
     }
-#endif
 }
 
 void
 SmallRTC::set (tmElements_t tminput)
 {
+  _srtcguard lock;
+  SmallRTC::_logEvent (RTC_EVT_SET);
   SmallRTC::set (tminput, false, false);
+  SmallRTC::_publish (tminput);
 }
 
-void
-SmallRTC::set (tmElements_t tm, bool enforce, bool internal)
+bool
+SmallRTC::set (tmElements_t tm, bool enforce, bool internal, time_t wake)
 {
   tmElements_t tst;
-  uint8_t controlReg, mask;
   time_t t = SmallRTC::doMakeTime (tm);
   SmallRTC::setnewmin (tm.Hour, tm.Minute, tm.Second);
 #ifndef SMALL_RTC_NO_INT
@@ -391,56 +607,160 @@ SmallRTC::set (tmElements_t tm, bool enforce, bool internal)
       SmallRTC::driftReset (t, true);
     }
 #endif
-  if (!(!enforce || (enforce && !internal)))
+  if (!(!enforce || (enforce && !internal)) || !SmallRTC::_busCheck ())
     {
-      return;
+      return false;
     }
-#ifndef SMALL_RTC_NO_DS3232
-  if (_ssrtc.m_rtctype == RTC_DS3231)
+  if (SmallRTC::_burstSet (t, wake))
     {
-      tm.Wday++;
-      tm.Month++;
-      rtc_ds.write (tm);
       SmallRTC::driftReset (t, false);
-      controlReg = rtc_ds.readRTC (0x0E);
-      mask = _BV (7);
-      if (controlReg & mask)
+      _sto->m_slew = 0;
+      return (wake != 0);
+    }
+  if (SmallRTC::_generic ())
+    {
+      SmallRTC::_busWrite (tm);
+      _sto->m_slew = 0;
+      SmallRTC::driftReset (t, false);
+      SmallRTC::checkStatus ();
+      SmallRTC::_busRead (tst);
+      if (_sto->b_operational)
         {
-          controlReg &= ~mask;
-          rtc_ds.writeRTC (0x0E, controlReg);
+          _sto->b_operational
+              = (tm.Year == tst.Year && tm.Month == tst.Month
+                 && tm.Day == tst.Day && tm.Hour == tst.Hour
+                 && tm.Minute == tst.Minute);
         }
-      SmallRTC::checkStatus ();
-      rtc_ds.read (tst);
     }
-#endif
-#ifndef SMALL_RTC_NO_PCF8563
-  if (_ssrtc.m_rtctype == RTC_PCF8563)
+  return false;
+}
+
+void
+SmallRTC::setAndWake (tmElements_t tminput, time_t when)
+{
+  _srtcguard lock;
+  SmallRTC::_logEvent (RTC_EVT_SET);
+  if (SmallRTC::set (tminput, false, false, when))
     {
-      SmallRTC::doBreakTime (t, tm);
-      rtc_pcf.setDate (tm.Day, tm.Wday, tm.Month + 1, 0, tm.Year);
-      SmallRTC::driftReset (t, false);
-      rtc_pcf.setTime (tm.Hour, tm.Minute, tm.Second);
-      rtc_pcf.clearStatus ();
-      tst.Year = rtc_pcf.getYear ();
-      tst.Month = rtc_pcf.getMonth () - 1;
-      tst.Day = rtc_pcf.getDay ();
-      tst.Hour = rtc_pcf.getHour ();
-      tst.Minute = rtc_pcf.getMinute ();
+      SmallRTC::_logEvent (RTC_EVT_ALARM);
+      if (_sto->m_rtc_pin)
+        {
+          esp_sleep_enable_ext0_wakeup ((gpio_num_t)_sto->m_rtc_pin, 0);
+        }
     }
-#endif
-  if (_ssrtc.b_operational)
+  else
     {
-      _ssrtc.b_operational
-          = (tm.Year == tst.Year && tm.Month == tst.Month && tm.Day == tst.Day
-             && tm.Hour == tst.Hour && tm.Minute == tst.Minute);
+      SmallRTC::atEpochWake (when);
+    }
+  SmallRTC::_publish (tminput);
+}
+
+// Writes the time with the control and status bits (and the minute alarm for
+// wake, zeroed if it can't be done here) in one burst, then checks it with a
+// single read of the status and seconds.  False for other RTCs.
+bool
+SmallRTC::_burstSet (time_t t, time_t &wake)
+{
+  uint8_t b[16], s[5], n = 9;
+  tmElements_t w, a;
+  time_t d = 0, r;
+  bool ok, ds = (_sto->m_rtctype == RTC_DS3231);
+  if (!ds && _sto->m_rtctype != RTC_PCF8563)
+    {
+      return false;
+    }
+  if (wake)
+    {
+      SmallRTC::driftReset (t, false);
+      r = SmallRTC::_toRTCTime (wake, false);
+      d = r - t;
+      if (r % 60 || d <= 0 || d >= 28L * 86400L)
+        {
+          wake = 0; // Needs more than a minute alarm, atEpochWake does it.
+        }
+      else
+        {
+          SmallRTC::doBreakTime (r, a);
+        }
+    }
+  SmallRTC::doBreakTime (t, w);
+  if (ds)
+    { // Alarms, control and status are written back as they are.
+      if (!SmallRTC::_readRegs (0x07, b + 7, 9))
+        {
+          return false;
+        }
+      b[0] = _srtcbcd (w.Second);
+      b[1] = _srtcbcd (w.Minute);
+      b[2] = _srtcbcd (w.Hour);
+      b[3] = w.Wday + 1;
+      b[4] = _srtcbcd (w.Day);
+      b[5] = _srtcbcd (w.Month + 1);
+      b[6] = _srtcbcd (tmYearToY2k (w.Year));
+      b[14] &= ~_BV (7); // Oscillator runs on battery.
+      b[15] &= ~_BV (7); // Oscillator stopped flag, flags ignore 1s.
+      if (wake)
+        {
+          b[11] = _srtcbcd (a.Minute);
+          b[12] = (d > 3600 ? _srtcbcd (a.Hour) : 0x80);
+          b[13] = (d > 86400L ? _srtcbcd (a.Day) : 0x80);
+          b[14] |= _BV (2) | _BV (1);
+          b[15] &= ~_BV (1);
+        }
+      if (!SmallRTC::_writeRegs (0x00, b, 16))
+        {
+          return false;
+        }
+      // The register pointer wraps from 0x12 to the seconds.
+      ok = SmallRTC::_readRegs (0x0F, s, 5) && !(s[0] & _BV (7));
+      s[0] = s[4];
+    }
+  else
+    { // Control_2 is written back as it is, so a countdown carries on (flags
+      // are ANDed when written), only a wake clears AF and sets AIE.
+      if (!SmallRTC::_readRegs (0x01, b + 1, 1))
+        {
+          return false;
+        }
+      b[0] = 0x00; // Clock running.
+      if (wake)
+        {
+          b[1] = (b[1] & ~_BV (3)) | _BV (1);
+        }
+      b[2] = _srtcbcd (w.Second); // Clears the low voltage bit too.
+      b[3] = _srtcbcd (w.Minute);
+      b[4] = _srtcbcd (w.Hour);
+      b[5] = _srtcbcd (w.Day);
+      b[6] = w.Wday;
+      b[7] = _srtcbcd (w.Month + 1);
+      b[8] = _srtcbcd (w.Year); // 1970 based, as setDate and read use it.
+      if (wake)
+        {
+          b[9] = _srtcbcd (a.Minute);
+          b[10] = (d > 3600 ? _srtcbcd (a.Hour) : 0x80);
+          b[11] = (d > 86400L ? _srtcbcd (a.Day) : 0x80);
+          b[12] = 0x80;
+          n = 13;
+        }
+      if (!SmallRTC::_writeRegs (0x00, b, n))
+        {
+          return false;
+        }
+      ok = SmallRTC::_readRegs (0x02, s, 1) && !(s[0] & _BV (7));
+    }
+  if (_sto->b_operational)
+    { // A second may have ticked over since.
+      _sto->b_operational
+          = ok && (_srtcdec (s[0] & 0x7F) + 60 - w.Second) % 60 <= 1;
     }
+  return true;
 }
 
 void
 SmallRTC::driftReset (time_t t, bool internal)
 {
   gsrdrifting *g
-      = (internal) ? &_ssrtc.srtcdrift.esprtc : &_ssrtc.srtcdrift.extrtc;
+      = (internal) ? &_sto->srtcdrift.esprtc : &_sto->srtcdrift.extrtc;
   g->last = t;
   g->slush = 0;
 }
@@ -454,7 +774,7 @@ SmallRTC::manageDrift (tmElements_t &p_tminput, bool internal)
   int32_t r;
   time_t t = SmallRTC::doMakeTime (p_tminput);
   gsrdrifting *g
-      = (internal) ? &_ssrtc.srtcdrift.esprtc : &_ssrtc.srtcdrift.extrtc;
+      = (internal) ? &_sto->srtcdrift.esprtc : &_sto->srtcdrift.extrtc;
   s = 0;
   _drift = g->drift;
   if (g->last == 0)
@@ -471,7 +791,7 @@ SmallRTC::manageDrift (tmElements_t &p_tminput, bool internal)
     } // Take the seconds and divide by Drift, rounding down.
   if (s > 0 && g->begin == 0)
     { // Drift offset needs to be dealt with.
-      if (_ssrtc.srtcdrift.paused)
+      if (_sto->srtcdrift.paused)
         {
           return; // Paused, don't process.
         }
@@ -479,13 +799,32 @@ SmallRTC::manageDrift (tmElements_t &p_tminput, bool internal)
       v = floor (d);
       r = ((g->fast ? -1 : 1) * s);
       t += r;
-      SmallRTC::doBreakTime (t, p_tminput);
-      SmallRTC::set (p_tminput, true, internal);
+      if (!_sto->b_slew)
+        {
+          SmallRTC::doBreakTime (t, p_tminput);
+          SmallRTC::set (p_tminput, true, internal);
+        }
+      else if (internal)
+        { // The ESP32 eases into it, so the time shown doesn't jump.
+          timeval a, o = { 0, 0 };
+          int64_t u;
+          adjtime (NULL, &o);
+          u = ((int64_t)o.tv_sec + r) * 1000000LL + o.tv_usec;
+          a.tv_sec = u / 1000000LL;
+          a.tv_usec = u % 1000000LL;
+          adjtime (&a, NULL);
+        }
+      else
+        { // Written with the next wake, see _epochWake.
+          _sto->m_slew += r;
+          SmallRTC::doBreakTime (t, p_tminput);
+        }
       g->last = t + (l - v); // Set the current time with the addition of
                              // any leftover seconds.
       g->slush = (d - v);    // Put the leftovers back into the slush to
                              // account for drift in decimal.
       g->drifted = true;
+      SmallRTC::_logEvent (RTC_EVT_DRIFT);
     }
   else if (l <= 0.0)
     {
@@ -498,12 +837,13 @@ SmallRTC::manageDrift (tmElements_t &p_tminput, bool internal)
 void
 SmallRTC::beginDrift (tmElements_t &p_tminput, bool internal)
 {
+  _srtcguard lock;
   if (!internal)
     {
-      internal = _ssrtc.b_forceesp32;
+      internal = _sto->b_forceesp32;
     }
   gsrdrifting *g
-      = (internal) ? &_ssrtc.srtcdrift.esprtc : &_ssrtc.srtcdrift.extrtc;
+      = (internal) ? &_sto->srtcdrift.esprtc : &_sto->srtcdrift.extrtc;
   if (g->begin == 0)
     {
       g->begin = SmallRTC::doMakeTime (p_tminput);
@@ -516,18 +856,19 @@ SmallRTC::beginDrift (tmElements_t &p_tminput, bool internal)
 void
 SmallRTC::pauseDrift (bool Pause)
 {
-  _ssrtc.srtcdrift.paused = Pause;
+  _sto->srtcdrift.paused = Pause;
 }
 
 void
 SmallRTC::endDrift (tmElements_t &p_tminput, bool internal)
 {
+  _srtcguard lock;
   if (!internal)
     {
-      internal = _ssrtc.b_forceesp32;
+      internal = _sto->b_forceesp32;
     }
   gsrdrifting *g
-      = (internal) ? &_ssrtc.srtcdrift.esprtc : &_ssrtc.srtcdrift.extrtc;
+      = (internal) ? &_sto->srtcdrift.esprtc : &_sto->srtcdrift.extrtc;
   time_t o, t = SmallRTC::doMakeTime (p_tminput);
   tmElements_t oT;
   int64_t d;
@@ -559,16 +900,70 @@ SmallRTC::endDrift (tmElements_t &p_tminput, bool internal)
     }
 }
 
+bool
+SmallRTC::sync (SmallRTCSource &source, uint8_t samples)
+{
+  int64_t o, best = 0, now;
+  uint32_t r, rtt = UINT32_MAX;
+  tmElements_t tm;
+  time_t t;
+  bool ci, ce;
+  for (uint8_t i = 0; i < samples; i++)
+    { // The quickest round trip has the least room for asymmetry.
+      if (source.sample (o, r) && r < rtt)
+        {
+          best = o;
+          rtt = r;
+        }
+    }
+  if (rtt == UINT32_MAX)
+    {
+      log_w ("SmallRTC:  Time source didn't answer.");
+      return false;
+    }
+  log_d ("SmallRTC:  Time source offset %lldus, round trip %luus.", best,
+         (unsigned long)rtt);
+  _srtcguard lock;
+  now = _srtcnowus () + best;
+  t = (time_t)(now / 1000000LL) + 1;
+  r = 1000000 - (uint32_t)(now % 1000000LL);
+  delay (r / 1000); // Wait for the next true second so it is set on the edge.
+  delayMicroseconds (r % 1000);
+  SmallRTC::doBreakTime (t, tm);
+  ci = SmallRTC::checkingDrift (true);
+  ce = !_sto->b_forceesp32 && SmallRTC::checkingDrift (false);
+  if (!ci && !ce)
+    {
+      SmallRTC::set (tm);
+      return true;
+    }
+  SmallRTC::_logEvent (RTC_EVT_SET);
+  if (ci)
+    {
+      SmallRTC::endDrift (tm, true);
+    }
+  if (ci && !ce && !_sto->b_forceesp32)
+    { // endDrift only set the ESP32, the RTC needs the time too.
+      SmallRTC::set (tm, true, false);
+    }
+  if (ce)
+    {
+      SmallRTC::endDrift (tm, false);
+    }
+  SmallRTC::_publish (tm);
+  return true;
+}
+
 uint32_t
 SmallRTC::getDrift (bool internal)
 {
   float t;
   if (!internal)
     {
-      internal = _ssrtc.b_forceesp32;
+      internal = _sto->b_forceesp32;
     }
-  t = (internal) ? _ssrtc.srtcdrift.esprtc.drift
-                 : _ssrtc.srtcdrift.extrtc.drift;
+  t = (internal) ? _sto->srtcdrift.esprtc.drift
+                 : _sto->srtcdrift.extrtc.drift;
   t *= 100.0;
   return (uint32_t)round (t);
 }
@@ -578,10 +973,10 @@ SmallRTC::setDrift (uint32_t drift, bool isfast, bool internal)
 {
   if (!internal)
     {
-      internal = _ssrtc.b_forceesp32;
+      internal = _sto->b_forceesp32;
     }
   gsrdrifting *g
-      = (internal) ? &_ssrtc.srtcdrift.esprtc : &_ssrtc.srtcdrift.extrtc;
+      = (internal) ? &_sto->srtcdrift.esprtc : &_sto->srtcdrift.extrtc;
   float T = drift;
   g->drift = (T / 100.0);
   g->fast = isfast;
@@ -592,33 +987,79 @@ SmallRTC::isFastDrift (bool internal)
 {
   if (!internal)
     {
-      internal = _ssrtc.b_forceesp32;
+      internal = _sto->b_forceesp32;
     }
-  return (internal) ? _ssrtc.srtcdrift.esprtc.fast
-                    : _ssrtc.srtcdrift.extrtc.fast;
+  return (internal) ? _sto->srtcdrift.esprtc.fast
+                    : _sto->srtcdrift.extrtc.fast;
 }
 
 bool
 SmallRTC::isNewMinute ()
 {
-   unsigned long t = _ssrtc.srtcdrift.newmin;
-  if (millis () >= t)
+  uint64_t t = esp_clk_rtc_time (); // Keeps counting in deep sleep.
+  if (t >= _sto->srtcdrift.newmin)
     {
-      _ssrtc.srtcdrift.newmin += 60000UL;
+      while (_sto->srtcdrift.newmin <= t)
+        {
+          _sto->srtcdrift.newmin += 60000000ULL;
+        }
       return true;
     }
   return false;
 }
 
+uint32_t
+SmallRTC::msToNewMinute ()
+{
+  uint64_t t = esp_clk_rtc_time ();
+  if (t >= _sto->srtcdrift.newmin)
+    {
+      return 0;
+    }
+  return (uint32_t)((_sto->srtcdrift.newmin - t + 999ULL) / 1000ULL);
+}
+
+bool
+SmallRTC::waitNewMinute (bool lightsleep)
+{
+  uint64_t t = esp_clk_rtc_time (), s;
+  if (t < _sto->srtcdrift.newmin)
+    {
+      if (lightsleep)
+        { // ESP-IDF calibrates the slow clock for light sleep itself.
+          esp_sleep_enable_timer_wakeup (_sto->srtcdrift.newmin - t);
+          _sto->m_etimers++;
+          s = t;
+          esp_light_sleep_start (); // Other wake sources can end this early.
+          esp_sleep_disable_wakeup_source (ESP_SLEEP_WAKEUP_TIMER);
+          t = esp_clk_rtc_time ();
+          _sto->m_elight += (t > s ? t - s : 0); // Not billed as awake.
+          if (_srtctimerat)
+            { // Put back the deep sleep wake this replaced, what's left of it.
+              esp_sleep_enable_timer_wakeup (
+                  _srtctimerat > t ? _srtctimerat - t : 1);
+            }
+        }
+      else
+        {
+          while (esp_clk_rtc_time () < _sto->srtcdrift.newmin)
+            {
+              vTaskDelay (1);
+            }
+        }
+    }
+  return SmallRTC::isNewMinute ();
+}
+
 bool
 SmallRTC::updatedDrift (bool internal)
 {
   if (!internal)
     {
-      internal = _ssrtc.b_forceesp32;
+      internal = _sto->b_forceesp32;
     }
-  return (internal) ? _ssrtc.srtcdrift.esprtc.drifted
-                    : _ssrtc.srtcdrift.extrtc.drifted;
+  return (internal) ? _sto->srtcdrift.esprtc.drifted
+                    : _sto->srtcdrift.extrtc.drifted;
 }
 
 bool
@@ -626,157 +1067,664 @@ SmallRTC::checkingDrift (bool internal)
 {
   if (!internal)
     {
-      internal = _ssrtc.b_forceesp32;
+      internal = _sto->b_forceesp32;
     }
-  return (internal) ? (_ssrtc.srtcdrift.esprtc.begin != 0)
-                    : (_ssrtc.srtcdrift.extrtc.begin != 0);
+  return (internal) ? (_sto->srtcdrift.esprtc.begin != 0)
+                    : (_sto->srtcdrift.extrtc.begin != 0);
 }
 
 void
 SmallRTC::clearAlarm ()
 {
+  _srtcguard lock;
+  SmallRTC::_logEvent (RTC_EVT_WAKE);
+  _sto->d_uahtotal += _sto->f_uahwake; // Start tallying this wake.
+  _sto->f_uahwake = 0;
+  _sto->m_ebytes = 0;
+  _sto->m_eadc = 0;
+  _sto->m_etimers = 0;
+  _sto->m_esleep = UINT32_MAX;
+  _sto->m_estart = esp_timer_get_time ();
+  _sto->m_elight = 0;
+  if (_sto->m_batwakes < 255)
+    {
+      _sto->m_batwakes++;
+    }
+  if (_sto->b_failover)
+    {
+      return;
+    }
+  SmallRTC::_secondClear ();
+  if (SmallRTC::_generic ())
+    {
+      SmallRTC::_busAlarm (0, 0, true, true);
+      return;
+    }
 #ifndef SMALL_RTC_NO_DS3232
-  if (_ssrtc.m_rtctype == RTC_DS3231)
+  if (_sto->m_rtctype == RTC_DS3231)
     {
       rtc_ds.clearAlarm (DS3232RTC::ALARM_2);
+      SmallRTC::_busCount (4);
       return;
     }
 #endif
 #ifndef SMALL_RTC_NO_PCF8563
-  if (_ssrtc.m_rtctype == RTC_PCF8563)
+  if (_sto->m_rtctype == RTC_PCF8563)
     {
       rtc_pcf.clearAlarm ();
+      SmallRTC::_busCount (4);
     }
 #endif
 }
 
 void
-SmallRTC::nextMinuteWake (bool enabled)
+SmallRTC::atSecondWake (uint8_t second, bool enabled)
 {
+  _srtcguard lock;
   tmElements_t t;
+  uint8_t s;
   SmallRTC::read (t);
-  SmallRTC::atMinuteWake (t.Minute + 1, enabled);
-}
-
-void
-SmallRTC::atTimeWake (uint8_t hour, uint8_t minute, bool enabled)
-{
-  SmallRTC::atMinuteWake (hour, minute, enabled);
+  s = (60 + (second % 60) - t.Second) % 60;
+  SmallRTC::_secondWake (t, (s ? s : 60), enabled);
 }
 
 void
-SmallRTC::atMinuteWake (uint8_t minute, bool enabled)
+SmallRTC::wakeAfterSeconds (uint32_t seconds, bool enabled)
 {
-  SmallRTC::atMinuteWake (RTC_OMIT_HOUR, minute, enabled);
+  _srtcguard lock;
+  tmElements_t t;
+  SmallRTC::read (t);
+  SmallRTC::_secondWake (t, seconds, enabled);
 }
 
 void
-SmallRTC::atMinuteWake (uint8_t hour, uint8_t minute, bool enabled)
+SmallRTC::_secondWake (tmElements_t &now, uint32_t seconds, bool enabled)
 {
-  bool b;
-  tmElements_t t;
-  int8_t wantedHour, wantedMinute;
-  uint64_t waitTime, workHour, workMin;
-  workHour = 0ULL;
-  wantedHour = (int8_t)hour;
-  wantedMinute = (int8_t)minute;
-#ifndef SMALL_RTC_NO_INT
-  if (_ssrtc.m_rtctype == RTC_ESP32 || _ssrtc.b_forceesp32)
+  uint8_t r, c[2], a[4] = { 0x80, 0x80, 0x80, 0x80 };
+  tmElements_t w;
+  time_t t;
+  if (!seconds)
     {
-      b = SmallRTC::_validateWakeup (wantedMinute, wantedHour, t, true);
-      if (hour != RTC_OMIT_HOUR)
+      seconds = 1;
+    }
+  t = SmallRTC::doMakeTime (now) + seconds;
+  SmallRTC::_logEvent (enabled ? RTC_EVT_ALARM : RTC_EVT_NOALARM);
+  if (_sto->m_rtctype == RTC_DS3231 && !_sto->b_forceesp32
+      && !_sto->b_failover && seconds < 28UL * 86400UL)
+    { // Alarm 1, matching as few fields as the distance allows, on the RTC's
+      // own time which doesn't have the pending slew yet.
+      time_t k = t - _sto->m_slew;
+      SmallRTC::doBreakTime (k, w);
+      a[0] = _srtcbcd (w.Second);
+      if (seconds >= 60)
         {
-          workHour = (uint64_t)wantedHour;
-          workHour *= 3600ULL;
+          a[1] = _srtcbcd (w.Minute);
         }
-      workMin = (uint64_t)wantedMinute;
-      workMin *= 60ULL;
-      workMin -= (uint64_t)t.Second;
-      waitTime = ((workHour + workMin) * 1000000ULL);
-      log_d ("Sleep:%llu", waitTime);
-      esp_sleep_enable_timer_wakeup (waitTime);
-    }
-
-#endif
-#ifndef SMALL_RTC_NO_DS3232
-  if (_ssrtc.m_rtctype == RTC_DS3231)
-    {
-      b = SmallRTC::_validateWakeup (wantedMinute, wantedHour, t, false);
-      if (hour == RTC_OMIT_HOUR)
+      if (seconds >= 3600)
         {
-          wantedHour = t.Hour;
+          a[2] = _srtcbcd (w.Hour);
         }
-      if (b)
+      if (seconds >= 86400)
         {
-          t.Wday++;
+          a[3] = _srtcbcd (w.Day);
+        }
+      SmallRTC::_writeRegs (0x07, a, 4);
+      if (SmallRTC::_readRegs (0x0F, &r, 1))
+        {
+          r &= ~_BV (0);
+          SmallRTC::_writeRegs (0x0F, &r, 1);
+        }
+      if (SmallRTC::_readRegs (0x0E, &r, 1))
+        {
+          r = (enabled ? (r | _BV (2) | _BV (0)) : (r & ~_BV (0)));
+          SmallRTC::_writeRegs (0x0E, &r, 1);
         }
-      rtc_ds.clearAlarm (DS3232RTC::ALARM_2);
-      rtc_ds.setAlarm ((hour != RTC_OMIT_HOUR ? DS3232RTC::ALM2_MATCH_HOURS
-                                              : DS3232RTC::ALM2_MATCH_MINUTES),
-                       wantedMinute, wantedHour, (t.Wday % 7) + 1);
-      rtc_ds.alarmInterrupt (DS3232RTC::ALARM_2, enabled);
     }
-#endif
-#ifndef SMALL_RTC_NO_PCF8563
-  if (_ssrtc.m_rtctype == RTC_PCF8563)
-    {
-      rtc_pcf.clearAlarm ();
-      b = SmallRTC::_validateWakeup (wantedMinute, wantedHour, t, false);
-      if (hour == RTC_OMIT_HOUR)
+  else if (_sto->m_rtctype == RTC_PCF8563 && !_sto->b_forceesp32
+           && !_sto->b_failover && seconds <= 255UL * 60UL)
+    { // Countdown timer, 1Hz up to 254 seconds, 1/60Hz after (whole minutes
+      // rounded up, though the first is whatever is left of the current).
+      // The first 1Hz tick isn't on the second, one more keeps it from
+      // going off early.
+      c[0] = 0x0;
+      SmallRTC::_writeRegs (0x0E, c, 1);
+      if (enabled)
         {
-          wantedHour = 99;
+          c[0] = (seconds < 255 ? 0x82 : 0x83);
+          c[1] = (seconds < 255 ? seconds + 1 : (seconds + 59) / 60);
+          SmallRTC::_writeRegs (0x0E, c, 2);
         }
+      if (SmallRTC::_readRegs (0x01, &r, 1))
+        { // TF cleared, TIE set, INT follows TF.
+          r &= ~(_BV (4) | _BV (2));
+          r = (enabled ? (r | _BV (0)) : (r & ~_BV (0)));
+          SmallRTC::_writeRegs (0x01, &r, 1);
+        }
+    }
+  else
+    {
+#ifndef SMALL_RTC_NO_INT
       if (enabled)
         {
-          rtc_pcf.setAlarm ((wantedMinute % 60), wantedHour, 99, 99);
+          SmallRTC::_timerArm (SmallRTC::_scaleSleep (seconds * 1000000ULL));
+          _sto->m_etimers++;
+          SmallRTC::_energyTally (seconds);
         }
       else
         {
-          rtc_pcf.resetAlarm ();
+          SmallRTC::_timerDisarm ();
         }
-    }
 #endif
-  if (_ssrtc.m_rtc_pin && enabled)
+      return;
+    }
+  if (enabled)
+    {
+      SmallRTC::_energyTally (seconds);
+    }
+  if (_sto->m_rtc_pin && enabled)
     {
-      esp_sleep_enable_ext0_wakeup ((gpio_num_t)_ssrtc.m_rtc_pin, 0);
+      esp_sleep_enable_ext0_wakeup ((gpio_num_t)_sto->m_rtc_pin, 0);
     }
 }
 
 void
-SmallRTC::setnewmin (uint8_t hrs, uint8_t mins, uint8_t secs)
+SmallRTC::_secondClear ()
 {
-  unsigned long t = millis ();  // Seconds.
-  if ((_ssrtc.srtcdrift.newlasthr == 25 || secs) &&
-    !(_ssrtc.srtcdrift.newlasthr == hrs && _ssrtc.srtcdrift.newlastm == mins))
-    {
-      _ssrtc.srtcdrift.newmin = t + ((60 - secs) * 1000UL);
-      _ssrtc.srtcdrift.newlasthr = hrs;
-      _ssrtc.srtcdrift.newlastm = mins;
+  uint8_t r, c = 0x0;
+  if (_sto->m_rtctype == RTC_DS3231 && SmallRTC::_readRegs (0x0F, &r, 1)
+      && (r & _BV (0)))
+    { // Alarm 1 is one shot, turn it off once it has fired.
+      r &= ~_BV (0);
+      SmallRTC::_writeRegs (0x0F, &r, 1);
+      if (SmallRTC::_readRegs (0x0E, &r, 1))
+        {
+          r &= ~_BV (0);
+          SmallRTC::_writeRegs (0x0E, &r, 1);
+        }
+    }
+  else if (_sto->m_rtctype == RTC_PCF8563
+           && SmallRTC::_readRegs (0x01, &r, 1) && (r & _BV (2)))
+    { // Same for the countdown timer, which would otherwise repeat.
+      r &= ~(_BV (2) | _BV (0));
+      SmallRTC::_writeRegs (0x01, &r, 1);
+      SmallRTC::_writeRegs (0x0E, &c, 1);
     }
 }
 
-uint8_t
-SmallRTC::temperature ()
+// Whether the DS3231's alarm 1 or the PCF8563's countdown is still on, true
+// for other RTCs.
+bool
+SmallRTC::_secondArmed ()
 {
-#ifndef SMALL_RTC_NO_DS3232
-  if (_ssrtc.m_rtctype == RTC_DS3231)
+  uint8_t r;
+  if (_sto->m_rtctype == RTC_DS3231)
     {
+      return !SmallRTC::_readRegs (0x0E, &r, 1) || (r & _BV (0));
+    }
+  if (_sto->m_rtctype == RTC_PCF8563)
+    {
+      return !SmallRTC::_readRegs (0x0E, &r, 1) || (r & _BV (7));
+    }
+  return true;
+}
+
+void
+SmallRTC::startTimer (uint32_t seconds)
+{
+  _srtcguard lock;
+  tmElements_t t;
+  SmallRTC::read (t);
+  _sto->srtctimer.start = SmallRTC::doMakeTime (t);
+  _sto->srtctimer.length = (seconds ? seconds : 1);
+  SmallRTC::_secondWake (t, _sto->srtctimer.length, true);
+}
+
+void
+SmallRTC::startStopwatch ()
+{
+  _srtcguard lock;
+  tmElements_t t;
+  SmallRTC::read (t);
+  _sto->srtctimer.start = SmallRTC::doMakeTime (t);
+  _sto->srtctimer.length = 0;
+}
+
+void
+SmallRTC::stopTimer ()
+{
+  _srtcguard lock;
+  tmElements_t t;
+  if (_sto->srtctimer.start && _sto->srtctimer.length)
+    { // Same length as startTimer so the same alarm or timer is turned off.
+      SmallRTC::read (t);
+      SmallRTC::_secondWake (t, _sto->srtctimer.length, false);
+    }
+  _sto->srtctimer.start = 0;
+  _sto->srtctimer.length = 0;
+}
+
+bool
+SmallRTC::timerRunning ()
+{
+  return (_sto->srtctimer.start != 0);
+}
+
+uint32_t
+SmallRTC::timerElapsed ()
+{
+  _srtcguard lock;
+  tmElements_t t;
+  if (!_sto->srtctimer.start)
+    {
+      return 0;
+    }
+  SmallRTC::read (t);
+  return SmallRTC::timerElapsed (t);
+}
+
+uint32_t
+SmallRTC::timerElapsed (tmElements_t &now)
+{
+  time_t t = SmallRTC::doMakeTime (now);
+  if (!_sto->srtctimer.start || t <= _sto->srtctimer.start)
+    {
+      return 0;
+    }
+  return (uint32_t)(t - _sto->srtctimer.start);
+}
+
+uint32_t
+SmallRTC::timerRemaining ()
+{
+  _srtcguard lock;
+  tmElements_t t;
+  if (!_sto->srtctimer.start || !_sto->srtctimer.length)
+    {
+      return 0;
+    }
+  SmallRTC::read (t);
+  return SmallRTC::timerRemaining (t);
+}
+
+uint32_t
+SmallRTC::timerRemaining (tmElements_t &now)
+{
+  uint32_t e = SmallRTC::timerElapsed (now);
+  if (!_sto->srtctimer.start || e >= _sto->srtctimer.length)
+    {
+      return 0;
+    }
+  return _sto->srtctimer.length - e;
+}
+
+bool
+SmallRTC::timerExpired ()
+{
+  return (_sto->srtctimer.start && _sto->srtctimer.length
+          && !SmallRTC::timerRemaining ());
+}
+
+void
+SmallRTC::nextMinuteWake (bool enabled)
+{
+  _srtcguard lock;
+  tmElements_t t;
+  time_t n, w;
+  SmallRTC::read (t);
+  n = SmallRTC::doMakeTime (t);
+  if (_sto->m_boundary == RTC_WAKE_HOUR)
+    {
+      w = SmallRTC::_wakeTarget (n, RTC_OMIT_HOUR, 0);
+    }
+  else if (_sto->m_boundary == RTC_WAKE_DAY)
+    {
+      w = SmallRTC::_wakeTarget (n, 0, 0);
+    }
+  else
+    {
+      w = n - (n % 60) + 60;
+    }
+  SmallRTC::_epochWake (t, w, enabled);
+}
+
+void
+SmallRTC::setWakeBoundary (uint8_t boundary)
+{
+  _sto->m_boundary = boundary;
+}
+
+uint8_t
+SmallRTC::getWakeBoundary ()
+{
+  return _sto->m_boundary;
+}
+
+void
+SmallRTC::atTimeWake (uint8_t hour, uint8_t minute, bool enabled)
+{
+  _srtcguard lock;
+  SmallRTC::atMinuteWake (hour, minute, enabled);
+}
+
+void
+SmallRTC::atMinuteWake (uint8_t minute, bool enabled)
+{
+  _srtcguard lock;
+  SmallRTC::atMinuteWake (RTC_OMIT_HOUR, minute, enabled);
+}
+
+void
+SmallRTC::atMinuteWake (uint8_t hour, uint8_t minute, bool enabled)
+{
+  tmElements_t t;
+  SmallRTC::read (t, false);
+  SmallRTC::_epochWake (
+      t, SmallRTC::_wakeTarget (SmallRTC::doMakeTime (t), hour, minute),
+      enabled);
+}
+
+void
+SmallRTC::atEpochWake (time_t when, bool enabled)
+{
+  _srtcguard lock;
+  tmElements_t t;
+  SmallRTC::read (t, false);
+  SmallRTC::_epochWake (t, when, enabled);
+}
+
+void
+SmallRTC::_epochWake (tmElements_t &now, time_t when, bool enabled)
+{
+  time_t n = SmallRTC::doMakeTime (now), r;
+  uint64_t waitTime, c;
+  double e;
+  // n came from the ESP32's clock, read() still takes an external RTC's time
+  // under useESP32.
+  bool esp = (_sto->m_rtctype == RTC_ESP32 || _sto->m_rtctype == RTC_UNKNOWN
+              || _sto->b_failover);
+  bool timer = (esp || _sto->b_forceesp32
+                || (SmallRTC::_generic () && !SmallRTC::_chip ()->alarm));
+#ifndef SMALL_RTC_NO_INT
+  if (_sto->b_slew)
+    { // Deep sleep forgets what adjtime still had to do, only n read from
+      // the ESP32's clock moves with it.
+      int64_t s = SmallRTC::_slewFold ();
+      if (esp)
+        {
+          n += (time_t)llround (s / 1000000.0);
+        }
+    }
+#endif
+  if (when <= n)
+    {
+      when = n + 1;
+    }
+  if (_sto->m_slew && enabled && !timer)
+    { // Slewed drift goes to the RTC with the alarm where it can.
+      gsrdrifting k = _sto->srtcdrift.extrtc;
+      tmElements_t tt;
+      bool b;
+      SmallRTC::doBreakTime (n, tt);
+      b = SmallRTC::set (tt, true, false, when);
+      _sto->srtcdrift.extrtc.last = k.last;
+      _sto->srtcdrift.extrtc.slush = k.slush;
+      if (b)
+        { // set counted the alarm.
+          SmallRTC::_energyTally ((uint32_t)(when > n ? when - n : 0));
+          SmallRTC::_logEvent (RTC_EVT_ALARM);
+          if (_sto->m_rtc_pin)
+            {
+              esp_sleep_enable_ext0_wakeup ((gpio_num_t)_sto->m_rtc_pin, 0);
+            }
+          return;
+        }
+    }
+  r = when;
+  if (enabled && !timer)
+    { // A drifting RTC gets there early (or late), wake when its counter
+      // shows what the true time will be.
+      r = SmallRTC::_toRTCTime (when, false);
+      if (r % 60 && r > n)
+        { // The one shot alarm is a running countdown's, don't take it.
+          if (!(SmallRTC::timerRunning () && _sto->srtctimer.length)
+              && ((_sto->m_rtctype == RTC_DS3231 && r - n < 28L * 86400L)
+                  || (_sto->m_rtctype == RTC_PCF8563 && r - n < 255)))
+            {
+              SmallRTC::_epochWake (now, when, false);
+              SmallRTC::_secondWake (now, (uint32_t)(r - n), true);
+              return;
+            }
+          r += 60 - (r % 60); // Only minute alarms, late beats early.
+        }
+    }
+  SmallRTC::_logEvent (enabled ? RTC_EVT_ALARM : RTC_EVT_NOALARM);
+  if (!_sto->b_failover && _sto->m_rtctype != RTC_ESP32
+      && !(SmallRTC::_generic () && !SmallRTC::_chip ()->alarm))
+    { // No ext0 in failover, a hung RTC could hold its pin low.
+      if (!SmallRTC::_alarmAt (r, n, enabled))
+        {
+          timer = true; // Further than the RTC's alarm can reach.
+        }
+      else if (enabled)
+        {
+          c = SmallRTC::timerRemaining (now);
+          if (c && n + (time_t)c < r && !SmallRTC::_secondArmed ())
+            { // A countdown that went off early (the PCF8563's minutes can)
+              // was cleared with this wake, set it again for what is left.
+              SmallRTC::_secondWake (now, (uint32_t)c, true);
+            }
+          SmallRTC::_energyTally ((uint32_t)(r > n ? r - n : 0));
+          if (_sto->m_rtc_pin)
+            {
+              esp_sleep_enable_ext0_wakeup ((gpio_num_t)_sto->m_rtc_pin, 0);
+            }
+        }
+    }
+#ifndef SMALL_RTC_NO_INT
+  if (timer && enabled)
+    {
+      waitTime = (uint64_t)(when - n) * 1000000ULL;
+      if (esp)
+        { // The ESP32's clock has the part of the second already gone.
+          c = (uint64_t)(_srtcnowus () % 1000000LL);
+          waitTime -= (c < waitTime ? c : 0);
+        }
+      if (SmallRTC::timerRunning () && _sto->srtctimer.length)
+        { // Don't sleep past a running countdown on the shared timer.
+          c = SmallRTC::timerRemaining (now) * 1000000ULL;
+          if (c && c < waitTime)
+            {
+              waitTime = c;
+            }
+        }
+      // The ESP32's clock drifts while asleep.
+      e = SmallRTC::_driftError (n + (time_t)(waitTime / 1000000ULL), true)
+          - SmallRTC::_driftError (n, true);
+      c = (uint64_t)(fabs (e) * 1000000.0);
+      waitTime = (e >= 0.0 ? waitTime + c : (c < waitTime ? waitTime - c : 0));
+      waitTime = SmallRTC::_scaleSleep (waitTime);
+      log_d ("Sleep:%llu", waitTime);
+      SmallRTC::_timerArm (waitTime);
+      _sto->m_etimers++;
+      SmallRTC::_energyTally ((uint32_t)(waitTime / 1000000ULL));
+    }
+#endif
+}
+
+// Sets the RTC's alarm for r (on the minute, in the RTC's time) matching as
+// few fields as the distance from n needs, false if it is out of reach.
+bool
+SmallRTC::_alarmAt (time_t r, time_t n, bool enabled)
+{
+  tmElements_t w;
+  time_t d = r - n;
+  SmallRTC::doBreakTime (r, w);
+  if (SmallRTC::_generic ())
+    {
+      if (d >= 86400L)
+        {
+          SmallRTC::_busAlarm (w.Hour, w.Minute, false, false);
+          return false;
+        }
+      return SmallRTC::_busAlarm ((d > 3600 ? w.Hour : RTC_OMIT_HOUR),
+                                  w.Minute, enabled, false);
+    }
+#ifndef SMALL_RTC_NO_DS3232
+  if (_sto->m_rtctype == RTC_DS3231)
+    {
+      rtc_ds.clearAlarm (DS3232RTC::ALARM_2);
+      SmallRTC::_busCount (8); // Flag and interrupt read-modify-writes.
+      if (d >= 28L * 86400L)
+        {
+          rtc_ds.alarmInterrupt (DS3232RTC::ALARM_2, false);
+          return false;
+        }
+      SmallRTC::_busCount (4);
+      rtc_ds.setAlarm ((d > 86400L  ? DS3232RTC::ALM2_MATCH_DATE
+                        : d > 3600 ? DS3232RTC::ALM2_MATCH_HOURS
+                                   : DS3232RTC::ALM2_MATCH_MINUTES),
+                       w.Minute, w.Hour, (d > 86400L ? w.Day : w.Wday + 1));
+      rtc_ds.alarmInterrupt (DS3232RTC::ALARM_2, enabled);
+      return true;
+    }
+#endif
+#ifndef SMALL_RTC_NO_PCF8563
+  if (_sto->m_rtctype == RTC_PCF8563)
+    {
+      rtc_pcf.clearAlarm ();
+      SmallRTC::_busCount (9);
+      if (!enabled || d >= 28L * 86400L)
+        {
+          rtc_pcf.resetAlarm ();
+          return !enabled;
+        }
+      rtc_pcf.setAlarm (w.Minute, (d > 3600 ? w.Hour : 99),
+                        (d > 86400L ? w.Day : 99), 99);
+      return true;
+    }
+#endif
+  return false;
+}
+
+// True time of the next hour:minute (or minute when hour is RTC_OMIT_HOUR),
+// minute can run past 59 into the following hour.
+time_t
+SmallRTC::_wakeTarget (time_t now, uint8_t hour, uint8_t minute)
+{
+  bool h = (hour != RTC_OMIT_HOUR);
+  time_t s = (h ? 86400 : 3600);
+  time_t t = now - (now % s) + (minute * 60) + (h ? hour * 3600 : 0);
+  while (t <= now)
+    {
+      t += s;
+    }
+  return t;
+}
+
+// Seconds the RTC's counter will be ahead (or behind when negative) of the
+// true time t, from the drift left since the last correction.
+double
+SmallRTC::_driftError (time_t t, bool internal)
+{
+  gsrdrifting *g
+      = (internal) ? &_sto->srtcdrift.esprtc : &_sto->srtcdrift.extrtc;
+  double e;
+  if (g->drift == 0.0 || g->begin != 0 || g->last == 0 || t <= g->last
+      || _sto->srtcdrift.paused)
+    {
+      return 0.0; // Nothing is being corrected, wake on the RTC's own time.
+    }
+  e = (t - g->last) / (double)g->drift;
+  return (g->fast ? e : -e);
+}
+
+// The RTC's time when the true time is t, rounded so an alarm set on it
+// never goes off before t.
+time_t
+SmallRTC::_toRTCTime (time_t t, bool internal)
+{
+  return t + (time_t)ceil (SmallRTC::_driftError (t, internal));
+}
+
+void
+SmallRTC::setnewmin (uint8_t hrs, uint8_t mins, uint8_t secs)
+{
+  uint64_t t = esp_clk_rtc_time (); // Microseconds, survives deep sleep.
+  if ((_sto->srtcdrift.newlasthr == 25 || secs) &&
+    !(_sto->srtcdrift.newlasthr == hrs && _sto->srtcdrift.newlastm == mins))
+    {
+      _sto->srtcdrift.newmin = t + ((60 - secs) * 1000000ULL);
+      _sto->srtcdrift.newlasthr = hrs;
+      _sto->srtcdrift.newlastm = mins;
+    }
+}
+
+uint8_t
+SmallRTC::temperature ()
+{
+  _srtcguard lock;
+#ifndef SMALL_RTC_NO_DS3232
+  if (_sto->m_rtctype == RTC_DS3231)
+    {
+      uint8_t r[2];
+      if (SmallRTC::_generic ())
+        { // Same quarter degree value the DS3232RTC library returns.
+          return (SmallRTC::_readRegs (0x11, r, 2)
+                      ? (uint8_t)(((int8_t)r[0] << 2) | (r[1] >> 6))
+                      : 255);
+        }
+      SmallRTC::_busCount (3);
       return rtc_ds.temperature ();
     }
 #endif
   return 255; // error
 }
 
+float
+SmallRTC::temperatureC (uint32_t maxagems)
+{
+  _srtcguard lock;
+  uint8_t r[2], s;
+  uint64_t now = SmallRTC::monotonicMicros ();
+  esp_chip_info_t ci;
+  if (_sto->m_tempstamp && now - _sto->m_tempstamp <= maxagems * 1000ULL)
+    {
+      return _sto->f_temp;
+    }
+  if (_sto->m_rtctype == RTC_DS3231 && !_sto->b_failover
+      && SmallRTC::_readRegs (0x11, r, 2))
+    { // Quarter degrees, from the last conversion (at most 64s old).
+      _sto->f_temp = (int16_t)((r[0] << 8) | (r[1] & 0xC0)) / 256.0f;
+      if (SmallRTC::_readRegs (0x0F, &s, 1) && !(s & _BV (2))
+          && SmallRTC::_readRegs (0x0E, &s, 1) && !(s & _BV (5)))
+        { // Start a fresh one for next time, without waiting on it.
+          s |= _BV (5);
+          SmallRTC::_writeRegs (0x0E, &s, 1);
+        }
+    }
+  else
+    {
+      esp_chip_info (&ci);
+      if (ci.model != CHIP_ESP32S3 && ci.model != CHIP_ESP32C6)
+        {
+          return NAN; // Nothing worth reading.
+        }
+      _sto->f_temp = temperatureRead ();
+    }
+  _sto->m_tempstamp = (now ? now : 1);
+  return _sto->f_temp;
+}
+
 uint8_t
 SmallRTC::getType ()
 {
-  return _ssrtc.m_rtctype;
+  return _sto->m_rtctype;
 }
 
 uint32_t
 SmallRTC::getADCPin ()
 {
-  return _ssrtc.m_adc_pin;
+  return _sto->m_adc_pin;
 }
 
 uint16_t
@@ -788,16 +1736,16 @@ SmallRTC::getLocalYearOffset ()
 float
 SmallRTC::getWatchyHWVer ()
 {
-  return _ssrtc.f_watchyhwver;
+  return _sto->f_watchyhwver;
 }
 
 void
 SmallRTC::useESP32 (bool enforce, bool need32K)
 {
 #ifndef SMALL_RTC_NO_INT
-  if (_ssrtc.m_rtctype != RTC_ESP32)
+  if (_sto->m_rtctype != RTC_ESP32)
     {
-      _ssrtc.b_forceesp32 = enforce;
+      _sto->b_forceesp32 = enforce;
     }
   if (need32K)
     {
@@ -809,9 +1757,9 @@ SmallRTC::useESP32 (bool enforce, bool need32K)
 bool
 SmallRTC::onESP32 ()
 {
-  if (_ssrtc.m_rtctype != RTC_ESP32)
+  if (_sto->m_rtctype != RTC_ESP32)
     {
-      return _ssrtc.b_forceesp32;
+      return _sto->b_forceesp32;
     }
   return false;
 }
@@ -832,20 +1780,101 @@ SmallRTC::doBreakTime (time_t &T, tmElements_t &p_tminout)
   p_tminout.Wday--;
 }
 
+// Batch versions of the above, the date is only worked out (civil from days)
+// when the day changes, which stored history mostly doesn't.
+void
+SmallRTC::breakTimes (const time_t *p_tinput, tmElements_t *p_tmoutput,
+                      size_t count)
+{
+  int64_t z, day = INT64_MIN, era, doe, yoe, doy, mp, y;
+  int32_t s;
+  tmElements_t d = {};
+  for (size_t i = 0; i < count; i++)
+    {
+      z = p_tinput[i] / 86400;
+      s = (int32_t)(p_tinput[i] % 86400);
+      if (s < 0)
+        {
+          s += 86400;
+          z--;
+        }
+      if (z != day)
+        {
+          day = z;
+          d.Wday = (uint8_t)(((z % 7) + 11) % 7); // 1970 began on a Thursday.
+          z += 719468;
+          era = (z >= 0 ? z : z - 146096) / 146097;
+          doe = z - era * 146097;
+          yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+          doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+          mp = (5 * doy + 2) / 153;
+          y = yoe + era * 400 + (mp >= 10);
+          d.Day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+          d.Month = (uint8_t)(mp < 10 ? mp + 2 : mp - 10);
+          d.Year = (uint8_t)(y - 1970);
+        }
+      d.Hour = s / 3600;
+      d.Minute = (s / 60) % 60;
+      d.Second = s % 60;
+      p_tmoutput[i] = d;
+    }
+}
+
+void
+SmallRTC::makeTimes (const tmElements_t *p_tminput, time_t *p_toutput,
+                     size_t count)
+{
+  int64_t days = 0, era, yoe, doy, y;
+  uint8_t ly = 0xFF, lm = 0xFF, ld = 0xFF, m;
+  for (size_t i = 0; i < count; i++)
+    {
+      const tmElements_t &t = p_tminput[i];
+      if (t.Day != ld || t.Month != lm || t.Year != ly)
+        { // Days from civil, March based so leap days fall at the end.
+          ly = t.Year;
+          lm = t.Month;
+          ld = t.Day;
+          m = lm + 1;
+          y = (int64_t)ly + 1970 - (m <= 2);
+          era = y / 400;
+          yoe = y - era * 400;
+          doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + ld - 1;
+          days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy
+                 - 719468;
+        }
+      p_toutput[i] = (time_t)(days * 86400 + t.Hour * 3600 + t.Minute * 60
+                              + t.Second);
+    }
+}
+
 bool
 SmallRTC::isOperating ()
 {
-  return _ssrtc.b_operational || _ssrtc.m_rtctype == RTC_ESP32
-         || _ssrtc.b_forceesp32;
+  return _sto->b_operational || _sto->m_rtctype == RTC_ESP32
+         || _sto->b_forceesp32;
 }
 
 void
 SmallRTC::checkStatus (bool reset_op)
 {
+  uint8_t r;
+  const srtcchip *c = SmallRTC::_chip ();
+  if (_sto->b_operational && c && c->stopbit && SmallRTC::_generic ())
+    {
+      _sto->b_operational
+          = (SmallRTC::_readRegs (c->stopreg, &r, 1) && !(r & c->stopbit));
+      if (reset_op && (r & c->stopbit))
+        {
+          r &= ~c->stopbit;
+          SmallRTC::_writeRegs (c->stopreg, &r, 1);
+        }
+      return;
+    }
 #ifndef SMALL_RTC_NO_DS3232
-  if (_ssrtc.b_operational && _ssrtc.m_rtctype == RTC_DS3231)
+  if (_sto->b_operational && _sto->m_rtctype == RTC_DS3231)
     {
-      _ssrtc.b_operational = !rtc_ds.oscStopped (reset_op);
+      _sto->b_operational = !rtc_ds.oscStopped (reset_op);
+      SmallRTC::_busCount (2);
     }
 #endif
 }
@@ -854,13 +1883,13 @@ float
 SmallRTC::getRTCBattery (bool critical)
 {
 #ifndef SMALL_RTC_NO_DS3232
-  if (_ssrtc.m_rtctype == RTC_PCF8563)
+  if (_sto->m_rtctype == RTC_PCF8563)
     {
       return (critical ? 3.45 : 3.58);
     }
 #endif
 #ifndef SMALL_RTC_NO_PCF8563
-  if (_ssrtc.m_rtctype == RTC_DS3231)
+  if (_sto->m_rtctype == RTC_DS3231)
     {
       return (critical ? 3.65 : 3.69); // 3.69 : 3.75 (TEST)
     }
@@ -868,71 +1897,1035 @@ SmallRTC::getRTCBattery (bool critical)
   return (critical ? 3.65 : 3.69); //(critical ? 3.45 : 3.49);
 }
 
-void
-SmallRTC::use32K (bool active)
+float
+SmallRTC::getBatteryVoltage (bool force)
 {
-  if (_ssrtc.m_rtctype == RTC_ESP32 || _ssrtc.b_forceesp32)
+  float v;
+  if (!_sto->m_adc_pin)
     {
-      _ssrtc.b_use32K = active;
+      return 0.0;
     }
+  if (!force && _sto->f_battery > 0.0 && _sto->m_batwakes < RTC_BAT_WAKES)
+    {
+      return _sto->f_battery;
+    }
+  v = SmallRTC::_batterySample ();
+  if (_sto->f_battery <= 0.0 || v < _sto->f_battery - RTC_BAT_DROP)
+    { // First sample or a real drop, don't let the filter hide it and look
+      // again next wake.
+      _sto->f_battery = v;
+      _sto->m_batwakes = RTC_BAT_WAKES;
+      return v;
+    }
+  _sto->f_battery += (v - _sto->f_battery) / RTC_BAT_WEIGHT;
+  _sto->m_batwakes = 0;
+  return _sto->f_battery;
 }
 
-bool
-SmallRTC::using32K ()
-{
-  return _ssrtc.b_use32K & _ssrtc.b_limitUnder;
-}
-
-bool
-SmallRTC::_validateWakeup (int8_t &mins, int8_t &hours, tmElements_t &t_data,
-                           bool b_internal)
+uint8_t
+SmallRTC::getBatteryPercent ()
 {
-  int8_t tmp = 0;
-  int8_t tmin = mins;
-  bool b_NoHour = false;
-  bool b_nextDay = false;
-  SmallRTC::read (t_data, b_internal);
-  if (hours == -1)
+  float v = SmallRTC::getBatteryVoltage ();
+  float l = SmallRTC::getRTCBattery (true);
+  if (v <= l)
     {
-      hours = 0;
-      b_NoHour = true;
+      return 0;
     }
-  else
+  if (v >= RTC_BAT_FULL)
     {
-      hours &= 0x7F;
+      return 100;
     }
-  tmp = (mins / 60);
-  tmin %= 60;
-  if (tmp)
+  return (uint8_t)round ((v - l) * 100.0 / (RTC_BAT_FULL - l));
+}
+
+// Oversampled, the highest and lowest reads are dropped.
+float
+SmallRTC::_batterySample ()
+{
+  uint32_t v, s = 0, lo = UINT32_MAX, hi = 0;
+  for (uint8_t i = 0; i < RTC_BAT_SAMPLES; i++)
     {
-      hours += tmp;
+      v = analogReadMilliVolts (_sto->m_adc_pin);
+      _sto->m_eadc++;
+      s += v;
+      lo = (v < lo ? v : lo);
+      hi = (v > hi ? v : hi);
     }
-  else if (tmin < t_data.Minute && b_NoHour && !b_internal)
+  s -= lo + hi;
+  return (s / (float)(RTC_BAT_SAMPLES - 2)) / 500.0f; // Halved by a divider.
+}
+
+void
+SmallRTC::use32K (bool active)
+{
+  if (_sto->m_rtctype == RTC_ESP32 || _sto->b_forceesp32)
     {
-      hours++;
+      _sto->b_use32K = active;
     }
-  b_nextDay |= (hours > 23 || hours > t_data.Hour);
-  hours %= 24;
-  if (b_internal)
-    {
-      mins -= t_data.Minute;
-      if (mins < 0)
+}
+
+bool
+SmallRTC::using32K ()
+{
+  return _sto->b_use32K & _sto->b_limitUnder;
+}
+
+void
+SmallRTC::useSlew (bool active)
+{
+  _sto->b_slew = active;
+}
+
+bool
+SmallRTC::usingSlew ()
+{
+  return _sto->b_slew;
+}
+
+float
+SmallRTC::getSlew (bool internal)
+{
+  timeval o = { 0, 0 };
+  if (!internal)
+    {
+      internal = _sto->b_forceesp32;
+    }
+  if (!internal)
+    {
+      return _sto->m_slew;
+    }
+  adjtime (NULL, &o);
+  return o.tv_sec + (o.tv_usec / 1000000.0f);
+}
+
+// Steps the ESP32's clock by what adjtime hasn't slewed yet, returns the
+// microseconds stepped.
+int64_t
+SmallRTC::_slewFold ()
+{
+  timeval z = { 0, 0 }, o = { 0, 0 }, now;
+  int64_t u;
+  if (adjtime (&z, &o) || (!o.tv_sec && !o.tv_usec))
+    {
+      return 0;
+    }
+  u = (int64_t)o.tv_sec * 1000000LL + o.tv_usec;
+  gettimeofday (&now, NULL);
+  u += (int64_t)now.tv_sec * 1000000LL + now.tv_usec;
+  now.tv_sec = u / 1000000LL;
+  now.tv_usec = u % 1000000LL;
+  settimeofday (&now, NULL);
+  return (int64_t)o.tv_sec * 1000000LL + o.tv_usec;
+}
+
+void
+SmallRTC::calibrateSlowClock ()
+{
+#ifndef SMALL_RTC_NO_INT
+  _sto->m_slowcal = rtc_clk_cal (RTC_CAL_RTC_MUX, RTC_CAL_CYCLES);
+  if (!_sto->m_slowcal)
+    {
+      log_w ("SmallRTC:  Slow clock calibration timed out.");
+    }
+#endif
+}
+
+float
+SmallRTC::getSlowClockFactor ()
+{
+#ifndef SMALL_RTC_NO_INT
+  float f;
+  uint32_t c = esp_clk_slowclk_cal_get (); // What ESP-IDF converts with.
+  if (_sto->m_slowcal && c)
+    {
+      f = (float)c / (float)_sto->m_slowcal;
+      if (f > 0.9f && f < 1.1f)
         {
-          mins += 60;
-          hours--;
+          return f;
         }
+    }
+#endif
+  return 1.0;
+}
 
-      if (!b_NoHour)
+// ESP-IDF converts deep sleep times with the period it measured at boot, which
+// the RC oscillator has moved on from by the time the Watchy goes to sleep, so
+// measure it again right before.  The 32K XTAL barely moves, the last
+// measurement (if any) is used.
+uint64_t
+SmallRTC::_scaleSleep (uint64_t us)
+{
+  if (_sto->b_limitUnder)
+    {
+      SmallRTC::calibrateSlowClock ();
+    }
+  return (uint64_t)((double)us * SmallRTC::getSlowClockFactor ());
+}
+
+// Arms the deep sleep timer wake and remembers when it is for, waitNewMinute
+// shares the timer.
+void
+SmallRTC::_timerArm (uint64_t us)
+{
+  SmallRTC::_timerDisarm ();
+  esp_sleep_enable_timer_wakeup (us);
+  _srtctimerat = esp_clk_rtc_time () + us;
+}
+
+void
+SmallRTC::_timerDisarm ()
+{
+  if (_srtctimerat)
+    { // ESP-IDF complains about disabling what isn't enabled.
+      esp_sleep_disable_wakeup_source (ESP_SLEEP_WAKEUP_TIMER);
+    }
+  _srtctimerat = 0;
+}
+
+bool
+SmallRTC::readAsync (SmallRTCJob &job, tmElements_t &p_tmoutput,
+                     SmallRTCDone done, void *arg)
+{
+  job.out = &p_tmoutput;
+  return SmallRTC::_queueJob (job, RTC_OP_READ, done, arg);
+}
+
+bool
+SmallRTC::setAsync (SmallRTCJob &job, tmElements_t tminput, SmallRTCDone done,
+                    void *arg)
+{
+  job.tm = tminput;
+  return SmallRTC::_queueJob (job, RTC_OP_SET, done, arg);
+}
+
+bool
+SmallRTC::atMinuteWakeAsync (SmallRTCJob &job, uint8_t minute, bool enabled,
+                             SmallRTCDone done, void *arg)
+{
+  job.minute = minute;
+  job.enabled = enabled;
+  return SmallRTC::_queueJob (job, RTC_OP_WAKE, done, arg);
+}
+
+bool
+SmallRTC::waitAsync (SmallRTCJob &job, uint32_t timeoutms)
+{
+  uint32_t s = millis ();
+  while (job.state == RTC_JOB_QUEUED)
+    {
+      if (timeoutms != portMAX_DELAY && (millis () - s) >= timeoutms)
+        {
+          return false;
+        }
+      vTaskDelay (1);
+    }
+  return (job.state == RTC_JOB_DONE);
+}
+
+bool
+SmallRTC::_queueJob (SmallRTCJob &job, uint8_t op, SmallRTCDone done,
+                     void *arg)
+{
+  SmallRTCJob *j = &job;
+  if (!SmallRTC::_startWorker ())
+    {
+      job.state = RTC_JOB_FAILED;
+      return false;
+    }
+  job.op = op;
+  job.rtc = this;
+  job.done = done;
+  job.arg = arg;
+  job.state = RTC_JOB_QUEUED;
+  if (xQueueSend (_srtcqueue, &j, 0) != pdTRUE)
+    {
+      job.state = RTC_JOB_FAILED;
+      return false;
+    }
+  return true;
+}
+
+bool
+SmallRTC::_startWorker ()
+{
+  bool mine;
+  taskENTER_CRITICAL (&_srtcmonomux);
+  mine = (_srtcworker == 0);
+  if (mine)
+    {
+      _srtcworker = 1;
+    }
+  taskEXIT_CRITICAL (&_srtcmonomux);
+  if (!mine)
+    { // Another task got here first, let it finish.
+      while (_srtcworker == 1)
+        {
+          vTaskDelay (1);
+        }
+      return (_srtcworker == 2);
+    }
+  if (_srtclock == NULL)
+    { // The constructor couldn't make it, kept once made.
+      _srtclock = xSemaphoreCreateRecursiveMutex ();
+    }
+  _srtcqueue = xQueueCreate (RTC_ASYNC_DEPTH, sizeof (SmallRTCJob *));
+  if (_srtclock == NULL || _srtcqueue == NULL
+      || xTaskCreate (SmallRTC::_asyncWorker, "SmallRTC", RTC_ASYNC_STACK,
+                      NULL, RTC_ASYNC_PRIORITY, NULL)
+             != pdPASS)
+    {
+      log_e ("SmallRTC:  Async worker could not be started.");
+      if (_srtcqueue != NULL)
+        {
+          vQueueDelete (_srtcqueue);
+          _srtcqueue = NULL;
+        }
+      _srtcworker = 0;
+      return false;
+    }
+  _srtcworker = 2;
+  return true;
+}
+
+void
+SmallRTC::_asyncWorker (void *p)
+{
+  SmallRTCJob *j;
+  tmElements_t tm;
+  for (;;)
+    {
+      if (xQueueReceive (_srtcqueue, &j,
+                         (_srtcowner ? pdMS_TO_TICKS (_srtcinterval)
+                                     : portMAX_DELAY))
+          != pdTRUE)
         {
-          hours -= t_data.Hour;
-          if (hours < 0)
+          SmallRTC *o = _srtcowner;
+          if (o)
             {
-              hours += 24;
+              o->read (tm); // Maintenance, drift is handled in here too.
             }
+          continue;
+        }
+      switch (j->op)
+        {
+        case RTC_OP_READ:
+          j->rtc->read (*j->out);
+          break;
+        case RTC_OP_SET:
+          j->rtc->set (j->tm);
+          break;
+        case RTC_OP_WAKE:
+          j->rtc->atMinuteWake (j->minute, j->enabled);
+          break;
         }
+      if (j->done)
+        {
+          j->done (*j, j->arg);
+        }
+      j->state = RTC_JOB_DONE; // Last touch, the owner may reuse it now.
+    }
+}
+
+void
+SmallRTC::beginMaintenance (uint32_t intervalms)
+{
+  tmElements_t tm;
+  _srtcinterval = (intervalms ? intervalms : 1);
+  if (SmallRTC::_startWorker ())
+    {
+      SmallRTC::read (tm); // Have a snapshot ready right away.
+      _srtcowner = this;
+    }
+}
+
+void
+SmallRTC::endMaintenance ()
+{
+  if (_srtcowner == this)
+    {
+      _srtcowner = NULL;
+    }
+}
+
+void
+SmallRTC::getSnapshot (SmallRTCSnapshot &snap)
+{
+  uint32_t b, e;
+  do
+    {
+      b = _seq.load (std::memory_order_acquire);
+      snap = _snap;
+      std::atomic_thread_fence (std::memory_order_acquire);
+      e = _seq.load (std::memory_order_relaxed);
+    }
+  while ((b & 1) || b != e);
+}
+
+void
+SmallRTC::_publish (tmElements_t &tm)
+{
+  SmallRTCSnapshot s;
+  s.time = SmallRTC::doMakeTime (tm);
+  s.stamp = millis ();
+  s.drift = SmallRTC::getDrift ();
+  s.fast = SmallRTC::isFastDrift ();
+  s.operational = SmallRTC::isOperating ();
+  taskENTER_CRITICAL (&_snapmux);
+  _seq.fetch_add (1, std::memory_order_relaxed);
+  std::atomic_thread_fence (std::memory_order_release);
+  _snap = s;
+  _seq.fetch_add (1, std::memory_order_release);
+  taskEXIT_CRITICAL (&_snapmux);
+}
+
+uint64_t
+SmallRTC::monotonicMicros ()
+{
+  uint64_t t, r;
+  bool reset = false;
+  taskENTER_CRITICAL (&_srtcmonomux);
+  t = esp_clk_rtc_time ();
+  if (t + 1000000ULL < _sto->m_monolast)
+    { // The RTC timer started over, carry on from where it was.
+      _sto->m_monobase += _sto->m_monolast;
+      reset = true;
     }
-  mins %= 60;
-  return b_nextDay;
+  else if (t < _sto->m_monolast)
+    {
+      t = _sto->m_monolast; // Calibration jitter, hold still.
+    }
+  _sto->m_monolast = t;
+  r = _sto->m_monobase + t;
+  taskEXIT_CRITICAL (&_srtcmonomux);
+  if (reset)
+    {
+      log_w ("SmallRTC:  RTC timer was reset, monotonic time carried over.");
+    }
+  return r;
+}
+
+uint8_t
+SmallRTC::crossCheck (SmallRTC *rtcs[], uint8_t count, tmElements_t &tm,
+                      uint8_t tolerance)
+{
+  time_t t[RTC_CROSS_MAX], m = 0;
+  tmElements_t r[RTC_CROSS_MAX];
+  uint8_t i, j, lo, le, agree = 0;
+  if (count > RTC_CROSS_MAX)
+    {
+      count = RTC_CROSS_MAX;
+    }
+  for (i = 0; i < count; i++)
+    {
+      rtcs[i]->read (r[i]);
+      t[i] = rtcs[i]->doMakeTime (r[i]);
+    }
+  for (i = 0; i < count; i++)
+    { // The median is the majority's time when one exists.
+      for (j = lo = le = 0; j < count; j++)
+        {
+          lo += (t[j] < t[i]);
+          le += (t[j] <= t[i]);
+        }
+      if (lo <= (count - 1) / 2 && (count - 1) / 2 < le)
+        {
+          m = t[i];
+          tm = r[i];
+          break;
+        }
+    }
+  for (i = 0; i < count; i++)
+    {
+      agree += (abs (t[i] - m) <= tolerance);
+    }
+  if (agree <= count / 2)
+    {
+      log_w ("SmallRTC:  No majority between %u RTCs.", count);
+      return 0;
+    }
+  for (i = 0; i < count; i++)
+    {
+      if (abs (t[i] - m) > tolerance && rtcs[i]->_sto->b_operational)
+        {
+          log_w ("SmallRTC:  RTC %u is off by %ld seconds, rejected.", i,
+                 (long)(t[i] - m));
+          rtcs[i]->_sto->b_operational = false;
+        }
+    }
+  return agree;
+}
+
+const srtcchip *
+SmallRTC::_chip ()
+{
+  uint8_t i;
+  for (i = 0; i < sizeof (_srtcchips) / sizeof (srtcchip); i++)
+    {
+      if (_srtcchips[i].type == _sto->m_rtctype)
+        {
+          return &_srtcchips[i];
+        }
+    }
+  return NULL;
+}
+
+bool
+SmallRTC::_generic ()
+{
+  return (SmallRTC::_chip () != NULL
+          && (_wire != &Wire || _sto->m_rtctype > RTC_ESP32));
+}
+
+uint8_t
+SmallRTC::_busAddr ()
+{
+  const srtcchip *c = SmallRTC::_chip ();
+  if (_addr)
+    {
+      return _addr;
+    }
+  return (c ? c->addr : RTC_DS_ADDR);
+}
+
+// Only the address asked about is touched, another instance may be using
+// the other RTC on the bus.
+bool
+SmallRTC::_busAck (uint8_t addr)
+{
+  _wire->beginTransmission (addr);
+  return !_wire->endTransmission ();
+}
+
+bool
+SmallRTC::_readRegs (uint8_t reg, uint8_t *buf, uint8_t len)
+{
+  uint8_t i;
+  _wire->beginTransmission (SmallRTC::_busAddr ());
+  _wire->write (reg);
+  if (_wire->endTransmission (false)
+      || _wire->requestFrom (SmallRTC::_busAddr (), len) != len)
+    {
+      SmallRTC::_busCount (1);
+      return false;
+    }
+  SmallRTC::_busCount (1 + len);
+  for (i = 0; i < len; i++)
+    {
+      buf[i] = _wire->read ();
+    }
+  return true;
+}
+
+bool
+SmallRTC::_writeRegs (uint8_t reg, const uint8_t *buf, uint8_t len)
+{
+  bool ok;
+  _wire->beginTransmission (SmallRTC::_busAddr ());
+  _wire->write (reg);
+  _wire->write (buf, len);
+  ok = !_wire->endTransmission ();
+  SmallRTC::_busCount (1 + len);
+  return ok;
+}
+
+void
+SmallRTC::_chipProbe ()
+{
+  uint8_t i;
+  for (i = 0; i < sizeof (_srtcchips) / sizeof (srtcchip); i++)
+    {
+      if (!(_srtcchips[i].layout & RTC_LAYOUT_PROBE)
+          || (_addr && _addr != _srtcchips[i].addr))
+        {
+          continue;
+        }
+      if (SmallRTC::_busAck (_srtcchips[i].addr))
+        {
+          SmallRTC::_chipInit (_srtcchips[i].type);
+          return;
+        }
+    }
+}
+
+void
+SmallRTC::_chipInit (uint8_t rtctype)
+{
+  uint8_t r, a[4] = { 0x80, 0x80, 0x80, 0x80 };
+  const srtcchip *c;
+  _sto->m_rtctype = rtctype;
+  _sto->m_rtc_pin = 27;
+  c = SmallRTC::_chip ();
+  if (c == NULL)
+    {
+      _sto->m_rtctype = RTC_UNKNOWN;
+      return;
+    }
+  _wire->beginTransmission (SmallRTC::_busAddr ());
+  _sto->b_operational = !_wire->endTransmission ();
+  if (!c->alarm)
+    {
+      _sto->m_rtc_pin = 0; // No alarm, wakes come from the ESP32 timer.
+    }
+  if (rtctype == RTC_DS3231 && SmallRTC::_readRegs (0x0E, &r, 1))
+    { // Oscillator on battery, interrupt instead of square wave.
+      r = (r & ~_BV (7)) | _BV (2);
+      SmallRTC::_writeRegs (0x0E, &r, 1);
+    }
+  else if (rtctype == RTC_PCF85063)
+    {
+      SmallRTC::_writeRegs (0x0B, a, 1); // Seconds alarm off.
+    }
+  if (c->alarm)
+    { // DS3231 treats this as every minute, the rest as no alarm.
+      SmallRTC::_writeRegs (c->alarm, a, c->alarmlen);
+      SmallRTC::_busAlarm (0, 0, (rtctype == RTC_DS3231), true);
+      if (rtctype == RTC_DS3231 && SmallRTC::_readRegs (c->ctrlreg, &r, 1))
+        {
+          r |= c->aie;
+          SmallRTC::_writeRegs (c->ctrlreg, &r, 1);
+        }
+    }
+  SmallRTC::checkStatus (_sto->b_operational);
+}
+
+bool
+SmallRTC::_busRead (tmElements_t &tm)
+{
+  uint8_t r[7];
+  const srtcchip *c = SmallRTC::_chip ();
+  bool df;
+  if (c == NULL || !SmallRTC::_readRegs (c->time, r, 7))
+    {
+      return false;
+    }
+  df = (c->layout & RTC_LAYOUT_DATEFIRST);
+  tm.Second = _srtcdec (r[0] & 0x7F);
+  tm.Minute = _srtcdec (r[1] & 0x7F);
+  tm.Hour = _srtcdec (r[2] & 0x3F);
+  tm.Day = _srtcdec (r[df ? 3 : 4] & 0x3F);
+  tm.Wday = r[df ? 4 : 3] & 0x7F;
+  if (c->layout & RTC_LAYOUT_WDAYBIT)
+    {
+      tm.Wday = (tm.Wday ? __builtin_ctz (tm.Wday) : 0);
+    }
+  else if (c->layout & RTC_LAYOUT_WDAY1)
+    {
+      tm.Wday--;
+    }
+  tm.Wday %= 7;
+  tm.Month = _srtcdec (r[5] & 0x1F) - 1;
+  tm.Year = y2kYearToTm (_srtcdec (r[6]));
+  return true;
+}
+
+bool
+SmallRTC::_busWrite (tmElements_t &tm)
+{
+  uint8_t r[7];
+  const srtcchip *c = SmallRTC::_chip ();
+  bool df;
+  if (c == NULL)
+    {
+      return false;
+    }
+  df = (c->layout & RTC_LAYOUT_DATEFIRST);
+  r[0] = _srtcbcd (tm.Second); // Clears the stop/low voltage bits too.
+  r[1] = _srtcbcd (tm.Minute);
+  r[2] = _srtcbcd (tm.Hour);
+  r[df ? 3 : 4] = _srtcbcd (tm.Day);
+  r[df ? 4 : 3] = ((c->layout & RTC_LAYOUT_WDAYBIT) ? _BV (tm.Wday % 7)
+                   : (c->layout & RTC_LAYOUT_WDAY1) ? tm.Wday + 1
+                                                    : tm.Wday);
+  r[5] = _srtcbcd (tm.Month + 1);
+  r[6] = _srtcbcd (tmYearToY2k (tm.Year));
+  return SmallRTC::_writeRegs (c->time, r, 7);
+}
+
+bool
+SmallRTC::_busAlarm (uint8_t hour, uint8_t minute, bool enabled,
+                     bool clearonly)
+{
+  uint8_t r, a[4] = { 0x80, 0x80, 0x80, 0x80 };
+  const srtcchip *c = SmallRTC::_chip ();
+  if (c == NULL || !c->alarm || !SmallRTC::_readRegs (c->flagreg, &r, 1))
+    {
+      return false;
+    }
+  r &= ~c->af;
+  SmallRTC::_writeRegs (c->flagreg, &r, 1);
+  if (clearonly)
+    {
+      return true;
+    }
+  a[0] = _srtcbcd (minute);
+  if (hour != RTC_OMIT_HOUR)
+    {
+      a[1] = _srtcbcd (hour);
+    }
+  SmallRTC::_writeRegs (c->alarm, a, c->alarmlen);
+  if (c->ctrlreg != c->flagreg)
+    {
+      SmallRTC::_readRegs (c->ctrlreg, &r, 1);
+    }
+  r = (enabled ? (r | c->aie) : (r & ~c->aie));
+  return SmallRTC::_writeRegs (c->ctrlreg, &r, 1);
+}
+
+bool
+SmallRTC::setCalibration (int8_t offset)
+{
+  _srtcguard lock;
+  uint8_t r;
+  const srtcchip *c = SmallRTC::_chip ();
+  if (c == NULL || !c->calreg)
+    {
+      return false;
+    }
+  if (_sto->m_rtctype == RTC_RV3028)
+    {
+      return SmallRTC::_eeOffset (offset);
+    }
+  r = ((uint8_t)offset & c->calmask);
+  return SmallRTC::_writeRegs (c->calreg, &r, 1);
+}
+
+int8_t
+SmallRTC::getCalibration ()
+{
+  _srtcguard lock;
+  uint8_t r, s, b[2];
+  int16_t v;
+  const srtcchip *c = SmallRTC::_chip ();
+  if (_sto->m_rtctype == RTC_RV3028)
+    { // 9 bits, the lowest is the top bit of the next register.
+      if (!SmallRTC::_readRegs (0x36, b, 2))
+        {
+          return 0;
+        }
+      v = (int16_t)(((b[0] << 1) | (b[1] >> 7)) << 7) >> 7;
+      return (int8_t)(v < -128 ? -128 : (v > 127 ? 127 : v));
+    }
+  if (c == NULL || !c->calreg || !SmallRTC::_readRegs (c->calreg, &r, 1))
+    {
+      return 0;
+    }
+  r &= c->calmask;
+  s = (c->calmask >> 1) + 1; // Sign bit of the field.
+  return (int8_t)((r & s) ? (r | ~c->calmask) : r);
+}
+
+// The RV-3028's offset registers are a copy of its EEPROM that the chip
+// reloads on its own, so the offset is written through to the EEPROM with
+// the refresh held off.  Bit 0 shares a register with the backup settings.
+bool
+SmallRTC::_eeOffset (int8_t offset)
+{
+  uint8_t b[2], e, u[2] = { 0x00, 0x11 }; // Update, RAM copy to EEPROM.
+  bool ok;
+  if (!SmallRTC::_readRegs (0x0F, &e, 1) || !SmallRTC::_readRegs (0x36, b, 2))
+    {
+      return false;
+    }
+  b[0] = (uint8_t)(offset >> 1);
+  b[1] = (b[1] & 0x7F) | ((offset & 1) << 7);
+  e |= _BV (3); // EERD, no automatic refresh.
+  ok = SmallRTC::_writeRegs (0x0F, &e, 1) && SmallRTC::_eeIdle ()
+       && SmallRTC::_writeRegs (0x36, b, 2)
+       && SmallRTC::_writeRegs (0x27, u, 1)
+       && SmallRTC::_writeRegs (0x27, u + 1, 1) && SmallRTC::_eeIdle ();
+  e &= ~_BV (3);
+  return SmallRTC::_writeRegs (0x0F, &e, 1) && ok;
+}
+
+// Waits for the RV-3028's EEbusy to clear.
+bool
+SmallRTC::_eeIdle ()
+{
+  uint8_t r;
+  uint32_t s = millis ();
+  while (SmallRTC::_readRegs (0x0E, &r, 1))
+    {
+      if (!(r & _BV (7)))
+        {
+          return true;
+        }
+      if (millis () - s > RTC_EE_TIMEOUT)
+        {
+          log_w ("SmallRTC:  RV-3028 EEPROM stayed busy.");
+          return false;
+        }
+      delay (1);
+    }
+  return false;
+}
+
+void
+SmallRTC::setBusPins (int8_t sda, int8_t scl)
+{
+  _sto->m_sda = sda;
+  _sto->m_scl = scl;
+}
+
+bool
+SmallRTC::onFailover ()
+{
+  return _sto->b_failover;
+}
+
+bool
+SmallRTC::_busCheck ()
+{
+  uint16_t t;
+  bool ok = true;
+  if (_sto->m_rtctype == RTC_UNKNOWN || _sto->m_rtctype == RTC_ESP32
+      || _sto->b_forceesp32)
+    {
+      return true;
+    }
+  t = _wire->getTimeOut (); // Wire is shared, the caller's is put back.
+  _wire->setTimeOut (RTC_BUS_TIMEOUT);
+  _wire->beginTransmission (SmallRTC::_busAddr ());
+  if (_wire->endTransmission ())
+    {
+      SmallRTC::_busRecover ();
+      _wire->beginTransmission (SmallRTC::_busAddr ());
+      ok = !_wire->endTransmission ();
+    }
+  _wire->setTimeOut (t);
+  if (!ok)
+    {
+      if (!_sto->b_failover)
+        {
+          log_w ("SmallRTC:  RTC not answering, using the ESP32 RTC.");
+          SmallRTC::_logEvent (RTC_EVT_FAILOVER);
+        }
+      _sto->b_failover = true;
+      return false;
+    }
+  if (_sto->b_failover)
+    {
+      log_i ("SmallRTC:  RTC answering again, leaving the ESP32 RTC.");
+      SmallRTC::_logEvent (RTC_EVT_FAILBACK);
+    }
+  _sto->b_failover = false;
+  return true;
+}
+
+// I2C bytes after the address, for the wake's charge.
+void
+SmallRTC::_busCount (uint16_t bytes)
+{
+  _sto->m_ebytes += bytes;
+}
+
+float
+SmallRTC::getWakeCharge ()
+{
+  return _sto->f_uahwake;
+}
+
+double
+SmallRTC::getTotalCharge ()
+{
+  return _sto->d_uahtotal + _sto->f_uahwake;
+}
+
+void
+SmallRTC::clearCharge ()
+{
+  _sto->f_uahwake = 0;
+  _sto->d_uahtotal = 0;
+  _sto->m_ebytes = 0;
+  _sto->m_eadc = 0;
+  _sto->m_etimers = 0;
+  _sto->m_esleep = UINT32_MAX;
+  _sto->m_estart = esp_timer_get_time ();
+  _sto->m_elight = 0;
+}
+
+// Works out this wake's charge when a wake is set, again if another is set,
+// with the sleep until the soonest of them.
+void
+SmallRTC::_energyTally (uint32_t sleep)
+{
+  const srtcenergy *e = &_srtcenergies[0];
+  uint8_t i, n = sizeof (_srtcenergies) / sizeof (srtcenergy);
+  int64_t a = esp_timer_get_time () - _sto->m_estart
+              - (int64_t)_sto->m_elight;
+  float uas;
+  for (i = 0; i < n; i++)
+    {
+      e = &_srtcenergies[i];
+      if (e->type == _sto->m_rtctype)
+        {
+          break;
+        }
+    }
+  if (sleep < _sto->m_esleep)
+    {
+      _sto->m_esleep = sleep;
+    }
+  uas = ((a > 0 ? a : 0) / 1000000.0f) * RTC_AWAKE_UA
+        + (float)_sto->m_esleep * e->sleepua
+        + _sto->m_ebytes * e->byteuas + _sto->m_eadc * e->adcuas
+        + _sto->m_etimers * e->timeruas;
+  _sto->f_uahwake = uas / 3600.0f;
+}
+
+void
+SmallRTC::_busRecover ()
+{
+  uint8_t i;
+  uint32_t f;
+  if (_sto->m_sda < 0 || _sto->m_scl < 0)
+    {
+      return;
+    }
+  f = _wire->getClock ();
+  _wire->end ();
+  pinMode (_sto->m_sda, INPUT_PULLUP);
+  pinMode (_sto->m_scl, OUTPUT_OPEN_DRAIN);
+  for (i = 0; i < 9 && !digitalRead (_sto->m_sda); i++)
+    { // Clock out whatever the RTC is holding SDA low for.
+      digitalWrite (_sto->m_scl, LOW);
+      delayMicroseconds (5);
+      digitalWrite (_sto->m_scl, HIGH);
+      delayMicroseconds (5);
+    }
+  digitalWrite (_sto->m_scl, HIGH); // Not clocked above if SDA was free.
+  delayMicroseconds (5);
+  pinMode (_sto->m_sda, OUTPUT_OPEN_DRAIN); // Stop condition.
+  digitalWrite (_sto->m_sda, LOW);
+  delayMicroseconds (5);
+  digitalWrite (_sto->m_sda, HIGH);
+  delayMicroseconds (5);
+  _wire->begin (_sto->m_sda, _sto->m_scl);
+  _wire->setClock (f); // begin goes back to the default.
+}
+
+void
+SmallRTC::clearEvents ()
+{
+#ifdef SMALL_RTC_EVENTLOG
+  _sto->srtclog.head = 0;
+  _sto->srtclog.tail = 0;
+  _sto->srtclog.used = 0;
+#endif
+}
+
+uint16_t
+SmallRTC::eventBytes ()
+{
+#ifdef SMALL_RTC_EVENTLOG
+  return _sto->srtclog.used;
+#else
+  return 0;
+#endif
+}
+
+void
+SmallRTC::beginEvents (SmallRTCLogCursor &cursor)
+{
+#ifdef SMALL_RTC_EVENTLOG
+  cursor.pos = _sto->srtclog.tail;
+  cursor.time = _sto->srtclog.base;
+#endif
+  cursor.done = 0;
+}
+
+bool
+SmallRTC::nextEvent (SmallRTCLogCursor &cursor, time_t &t, uint8_t &code)
+{
+#ifdef SMALL_RTC_EVENTLOG
+  uint8_t l;
+  int32_t d;
+  if (cursor.done >= _sto->srtclog.used)
+    {
+      return false;
+    }
+  l = SmallRTC::_logDecode (cursor.pos, code, d);
+  cursor.pos = (cursor.pos + l) % SMALL_RTC_EVENTLOG;
+  cursor.done += l;
+  cursor.time += d;
+  t = cursor.time;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+SmallRTC::dumpEvents (Print &out)
+{
+  SmallRTCLogCursor c;
+  time_t t;
+  uint8_t code;
+  SmallRTC::beginEvents (c);
+  while (SmallRTC::nextEvent (c, t, code))
+    {
+      out.printf ("%lld,%u\n", (long long)t, code);
+    }
+}
+
+void
+SmallRTC::_logEvent (uint8_t code)
+{
+#ifdef SMALL_RTC_EVENTLOG
+  gsrlog *g = &_sto->srtclog;
+  uint8_t b[6], i, l = 0, c;
+  int32_t d;
+  uint32_t z;
+  time_t t = time (NULL);
+  if (!g->used)
+    {
+      g->base = t;
+      g->last = t;
+    }
+  d = (int32_t)(t - g->last);
+  z = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31); // Zigzag, sets go back.
+  b[l++] = code;
+  do
+    {
+      b[l++] = (z & 0x7F) | (z > 0x7F ? 0x80 : 0);
+      z >>= 7;
+    }
+  while (z);
+  while (g->used && SMALL_RTC_EVENTLOG - g->used < l)
+    { // Full, drop the oldest events.
+      i = SmallRTC::_logDecode (g->tail, c, d);
+      g->base += d;
+      g->tail = (g->tail + i) % SMALL_RTC_EVENTLOG;
+      g->used -= i;
+    }
+  for (i = 0; i < l; i++)
+    {
+      g->data[g->head] = b[i];
+      g->head = (g->head + 1) % SMALL_RTC_EVENTLOG;
+    }
+  g->used += l;
+  g->last = t;
+#endif
+}
+
+uint8_t
+SmallRTC::_logDecode (uint16_t pos, uint8_t &code, int32_t &delta)
+{
+#ifdef SMALL_RTC_EVENTLOG
+  uint8_t b, l = 1, s = 0;
+  uint32_t z = 0;
+  code = _sto->srtclog.data[pos];
+  do
+    {
+      b = _sto->srtclog.data[(pos + l++) % SMALL_RTC_EVENTLOG];
+      z |= (uint32_t)(b & 0x7F) << s;
+      s += 7;
+    }
+  while (b & 0x80);
+  delta = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+  return l;
+#else
+  return 0;
+#endif
 }
 
 String
@@ -952,3 +2945,71 @@ SmallRTC::_getValue (String data, char separator, int index)
     }
   return found > index ? data.substring (strIndex[0], strIndex[1]) : "";
 }
+
+SmallRTCSNTP::SmallRTCSNTP (UDP &udp, const char *server, uint16_t port,
+                            uint32_t timeoutms)
+    : _udp (&udp), _host (server), _port (port), _timeout (timeoutms)
+{
+}
+
+SmallRTCSNTP::SmallRTCSNTP (UDP &udp, IPAddress server, uint16_t port,
+                            uint32_t timeoutms)
+    : _udp (&udp), _host (NULL), _ip (server), _port (port),
+      _timeout (timeoutms)
+{
+}
+
+bool
+SmallRTCSNTP::sample (int64_t &offset, uint32_t &rtt)
+{
+  uint8_t p[48], r[48];
+  int64_t t1, t2, t3, t4, d;
+  uint32_t start;
+  int ok;
+  memset (p, 0, sizeof (p));
+  p[0] = 0x23; // Version 4, client.
+  _srtcntpput (p + 40, _srtcnowus ()); // Comes back as the originate time.
+  if (!_udp->begin (RTC_NTP_LOCAL))
+    {
+      return false;
+    }
+  ok = (_host) ? _udp->beginPacket (_host, _port)
+               : _udp->beginPacket (_ip, _port);
+  if (ok == 1)
+    {
+      _udp->write (p, sizeof (p));
+      t1 = _srtcnowus ();
+      ok = _udp->endPacket ();
+    }
+  if (ok != 1)
+    {
+      _udp->stop ();
+      return false;
+    }
+  start = millis ();
+  while (_udp->parsePacket () < (int)sizeof (r))
+    {
+      if (millis () - start > _timeout)
+        {
+          _udp->stop ();
+          return false;
+        }
+      delay (1);
+    }
+  t4 = _srtcnowus ();
+  _udp->read (r, sizeof (r));
+  _udp->stop ();
+  // Needs to be a server reply to this request, not unsynchronized or a
+  // kiss-o'-death.
+  if ((r[0] & 0x07) != 4 || (r[0] >> 6) == 3 || r[1] == 0
+      || memcmp (r + 24, p + 40, 8) != 0)
+    {
+      return false;
+    }
+  t2 = _srtcntpget (r + 32);
+  t3 = _srtcntpget (r + 40);
+  offset = ((t2 - t1) + (t3 - t4)) / 2;
+  d = (t4 - t1) - (t3 - t2);
+  rtt = (d > 0) ? (uint32_t)d : 0;
+  return true;
+}
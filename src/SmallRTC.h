@@ -65,6 +65,17 @@
  *                                   Drift now requires it to be unpaused.
  * Version 2.4.7 January   23, 2026 : Fixed New Minute variable, wrong type.
  *                                   Added sysBoot to help with New Minute.
+ * Version 2.4.8 October   18, 2026 : Added RV-3028, RV-8803, PCF85063 and
+ *                                   DS1307 through register maps.
+ *                                   Added more than one instance, async jobs,
+ *                                   maintenance mode and snapshots.
+ *                                   Added second and countdown wakes, wake
+ *                                   boundaries, time sources with sync, bus
+ *                                   failover, event log and slewed drift.
+ *                                   Added calibrated slow clock sleeps, charge
+ *                                   estimates, monotonicMicros, cached battery
+ *                                   and temperature, batch time conversions.
+ *                                   Added the test/ simulator.
  *
  * This library offers an alternative to the WatchyRTC library, but also
  * provides a 100% time.h and timelib.h compliant RTC library.
@@ -100,6 +111,8 @@
 //  #define SMALL_RTC_NO_DS3232
 //  #define SMALL_RTC_NO_PCF8563
 //  #define SMALL_RTC_NO_INT
+//  #define SMALL_RTC_EVENTLOG 256  // Bytes of RTC memory for the event log.
+//  #define RTC_AWAKE_UA 30000      // Awake current for getWakeCharge (uA).
 
 #include <TimeLib.h>
 #ifndef SMALL_RTC_NO_DS3232
@@ -116,9 +129,18 @@
 #pragma message "SmallRTC: No support for ESP32 RTC"
 #endif
 #include "esp_chip_info.h"
+#include "esp_private/esp_clk.h"
+#include "esp_timer.h"
 #include "soc/rtc.h"
 #include <Arduino.h>
+#include <Udp.h>
 #include <Wire.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <sys/time.h>
 #include <time.h>
 #ifndef CHIP_ESP32C6
 #define CHIP_ESP32C6 13
@@ -130,6 +152,49 @@
 #define RTC_DS3231 1
 #define RTC_PCF8563 2
 #define RTC_ESP32 3
+#define RTC_RV3028 4
+#define RTC_RV8803 5
+#define RTC_PCF85063 6
+#define RTC_DS1307 7
+#define RTC_BUS_TIMEOUT 10 // Milliseconds a Wire transaction may take.
+#define RTC_CROSS_MAX 8    // RTCs crossCheck compares at most.
+#define RTC_EE_TIMEOUT 100 // Milliseconds an RV-3028 EEPROM update may take.
+#define RTC_WAKE_MINUTE 0
+#define RTC_WAKE_HOUR 1
+#define RTC_WAKE_DAY 2
+#define RTC_EVT_INIT 1
+#define RTC_EVT_WAKE 2
+#define RTC_EVT_SET 3
+#define RTC_EVT_DRIFT 4
+#define RTC_EVT_ALARM 5
+#define RTC_EVT_NOALARM 6
+#define RTC_EVT_FAILOVER 7
+#define RTC_EVT_FAILBACK 8
+#define RTC_LAYOUT_DATEFIRST 1 // Day of month comes before the weekday.
+#define RTC_LAYOUT_WDAY1 2     // Weekday is 1 to 7 instead of 0 to 6.
+#define RTC_LAYOUT_WDAYBIT 4   // Weekday is a single bit.
+#define RTC_LAYOUT_PROBE 8     // Address is unique enough to detect.
+#define RTC_CAL_CYCLES 1024 // Slow clock cycles measured per calibration.
+#define RTC_JOB_IDLE 0
+#define RTC_JOB_QUEUED 1
+#define RTC_JOB_DONE 2
+#define RTC_JOB_FAILED 3
+#define RTC_ASYNC_DEPTH 4      // Jobs the worker can have waiting.
+#define RTC_ASYNC_STACK 3072   // Worker task stack size.
+#define RTC_ASYNC_PRIORITY 1   // Worker task priority.
+#define RTC_BAT_SAMPLES 8      // ADC reads per battery sample.
+#define RTC_BAT_WAKES 10       // Wakes between battery samples.
+#define RTC_BAT_WEIGHT 4       // Battery filter keeps 1/4 of a new sample.
+#define RTC_BAT_DROP 0.05      // Volts under the filter that reset it.
+#define RTC_BAT_FULL 4.15      // Volts counted as 100%.
+#define RTC_TEMP_AGE 60000     // Milliseconds a temperature is reused for.
+#ifndef RTC_AWAKE_UA
+#define RTC_AWAKE_UA 30000     // Board current while awake (uA).
+#endif
+#define RTC_SYNC_SAMPLES 4     // Time source samples sync takes.
+#define RTC_NTP_PORT 123
+#define RTC_NTP_LOCAL 2390     // Local UDP port for SNTP replies.
+#define RTC_NTP_TIMEOUT 1000   // Milliseconds to wait for an SNTP reply.
 
 struct gsrdrifting final
 {
@@ -148,13 +213,66 @@ struct gsrdrift final
   gsrdrifting esprtc;   // Drift value for the internal RTC.
   gsrdrifting extrtc;   // Drift value for an internal RTC (if one is
                         // working/present).
-  unsigned long newmin; // Detect new minute based on last load using millis.
+  uint64_t newmin;      // Next new minute on the RTC timer (microseconds).
   uint8_t newlasthr;    // Keeps the last hour/min of the new minute test.
   uint8_t newlastm;     // These two avoid run-on situations.
   bool paused;          // Means something the user of this library is asking
                         // that no drift offsets happen during this time.
 };
 
+struct gsrtimer final
+{
+  time_t start;    // When the countdown/stopwatch started, 0 when stopped.
+  uint32_t length; // Countdown length in seconds, 0 for a stopwatch.
+};
+
+#ifdef SMALL_RTC_EVENTLOG
+struct gsrlog final
+{
+  time_t base;   // Time the oldest event's delta is from.
+  time_t last;   // Time of the newest event.
+  uint16_t head; // Where the next event goes.
+  uint16_t tail; // Oldest event.
+  uint16_t used; // Bytes in use.
+  uint8_t data[SMALL_RTC_EVENTLOG]; // Code, then zigzag varint delta.
+};
+#endif
+
+struct SmallRTCLogCursor
+{
+  uint16_t pos;
+  uint16_t done;
+  time_t time;
+};
+
+struct srtcchip final
+{
+  uint8_t type;     // RTC_ type this describes.
+  uint8_t addr;     // I2C address.
+  uint8_t time;     // Seconds register, 7 time registers follow.
+  uint8_t layout;   // RTC_LAYOUT_ bits.
+  uint8_t stopreg;  // Register holding the oscillator stopped bit.
+  uint8_t stopbit;  // Oscillator stopped/low voltage bit, 0 for none.
+  uint8_t alarm;    // Minute alarm register, 0 for no alarm.
+  uint8_t alarmlen; // Alarm registers from minute onward.
+  uint8_t ctrlreg;  // Register with the alarm interrupt enable.
+  uint8_t aie;      // Alarm interrupt enable bit.
+  uint8_t flagreg;  // Register with the alarm flag.
+  uint8_t af;       // Alarm flag bit.
+  uint8_t calreg;   // Aging/offset register, 0 for none.
+  uint8_t calmask;  // Bits of the signed offset in calreg.
+};
+
+struct srtcenergy final
+{
+  uint8_t type;    // RTC_ type this is for.
+  float sleepua;   // Deep sleep current, ESP32 and RTC (uA).
+  float byteuas;   // Charge per I2C byte (uA seconds).
+  float adcuas;    // Charge per ADC read (uA seconds).
+  float timeruas;  // Charge per ESP32 sleep timer set (uA seconds), the
+                   // timer's own draw is part of sleepua.
+};
+
 struct __srtcsto
 {
   uint8_t m_rtctype;
@@ -166,6 +284,86 @@ struct __srtcsto
   uint8_t m_rtc_pin;
   gsrdrift srtcdrift;
   bool b_limitUnder;
+  uint32_t m_slowcal;  // Slow clock period measured for the last sleep
+                       // (Q13.19 microseconds).
+  gsrtimer srtctimer;  // Countdown/stopwatch kept on the RTC.
+  uint8_t m_boundary;  // RTC_WAKE_ boundary nextMinuteWake uses.
+  bool b_failover;     // RTC stopped answering, the ESP32 RTC is used.
+  int8_t m_sda;        // Bus pins for recovery, -1 if unknown.
+  int8_t m_scl;
+  uint64_t m_monobase; // Added to the RTC timer by monotonicMicros.
+  uint64_t m_monolast; // Last RTC timer value monotonicMicros saw.
+  float f_battery;     // Filtered battery voltage, 0 until sampled.
+  uint8_t m_batwakes;  // Wakes since the battery was sampled.
+  float f_temp;        // Last temperature in Celsius.
+  uint64_t m_tempstamp; // monotonicMicros of f_temp, 0 for none.
+  bool b_slew;         // Drift is slewed instead of stepped.
+  int32_t m_slew;      // Seconds the RTC needs adding that aren't written.
+  float f_uahwake;     // Estimated charge of this wake (uAh).
+  double d_uahtotal;   // Before this wake (uAh).
+  uint32_t m_ebytes;   // I2C bytes this wake (library calls estimated).
+  uint32_t m_eadc;     // Battery ADC reads this wake.
+  uint32_t m_etimers;  // ESP32 sleep timers set this wake.
+  uint32_t m_esleep;   // Shortest sleep set this wake (seconds).
+  int64_t m_estart;    // esp_timer_get_time when this wake started.
+  uint64_t m_elight;   // Light sleep this wake (microseconds), esp_timer
+                       // keeps counting through it.
+#ifdef SMALL_RTC_EVENTLOG
+  gsrlog srtclog;      // Event log, see beginEvents.
+#endif
+};
+
+class SmallRTC;
+struct SmallRTCJob;
+typedef void (*SmallRTCDone) (SmallRTCJob &job, void *arg);
+
+struct SmallRTCJob
+{
+  volatile uint8_t state; // RTC_JOB_* value, poll this or use waitAsync.
+  uint8_t op;             // Which operation the worker should run.
+  SmallRTC *rtc;          // Instance the job runs against.
+  tmElements_t *out;      // readAsync destination.
+  tmElements_t tm;        // setAsync source.
+  uint8_t minute;         // atMinuteWakeAsync values.
+  bool enabled;
+  SmallRTCDone done; // Called from the worker task when finished.
+  void *arg;
+};
+
+struct SmallRTCSnapshot
+{
+  time_t time;      // Time from the last read or set.
+  uint32_t stamp;   // millis () when it was taken.
+  uint32_t drift;   // Drift value in 100ths of a second (as getDrift).
+  bool fast;        // The drift is fast.
+  bool operational; // isOperating at that moment.
+};
+
+class SmallRTCSource
+{
+public:
+  virtual ~SmallRTCSource () {}
+  // One measurement against the ESP32's clock, offset is how far ahead of it
+  // the source is and rtt the round trip (both in microseconds).
+  virtual bool sample (int64_t &offset, uint32_t &rtt) = 0;
+};
+
+class SmallRTCSNTP : public SmallRTCSource
+{
+public:
+  SmallRTCSNTP (UDP &udp, const char *server = "pool.ntp.org",
+                uint16_t port = RTC_NTP_PORT,
+                uint32_t timeoutms = RTC_NTP_TIMEOUT);
+  SmallRTCSNTP (UDP &udp, IPAddress server, uint16_t port = RTC_NTP_PORT,
+                uint32_t timeoutms = RTC_NTP_TIMEOUT);
+  bool sample (int64_t &offset, uint32_t &rtt) override;
+
+private:
+  UDP *_udp;
+  const char *_host; // NULL when _ip is used.
+  IPAddress _ip;
+  uint16_t _port;
+  uint32_t _timeout;
 };
 
 class SmallRTC
@@ -180,16 +378,35 @@ public:
 
 public:
   SmallRTC ();
+  SmallRTC (__srtcsto &store, TwoWire &wire = Wire, uint8_t address = 0);
   void init ();
+  void init (uint8_t rtctype);
   void sysBoot ();
   void setDateTime (String datetime);
+  bool sync (SmallRTCSource &source, uint8_t samples = RTC_SYNC_SAMPLES);
   void read (tmElements_t &p_tmoutput);
   void set (tmElements_t tminput);
+  void setAndWake (tmElements_t tminput, time_t when);
   void clearAlarm ();
   void nextMinuteWake (bool enabled = true);
+  void setWakeBoundary (uint8_t boundary);
+  uint8_t getWakeBoundary ();
   void atMinuteWake (uint8_t minute, bool enabled = true);
   void atTimeWake (uint8_t hour, uint8_t minute, bool enabled = true);
+  void atEpochWake (time_t when, bool enabled = true);
+  void atSecondWake (uint8_t second, bool enabled = true);
+  void wakeAfterSeconds (uint32_t seconds, bool enabled = true);
+  void startTimer (uint32_t seconds);
+  void startStopwatch ();
+  void stopTimer ();
+  bool timerRunning ();
+  uint32_t timerElapsed ();
+  uint32_t timerElapsed (tmElements_t &now);
+  uint32_t timerRemaining ();
+  uint32_t timerRemaining (tmElements_t &now);
+  bool timerExpired ();
   uint8_t temperature ();
+  float temperatureC (uint32_t maxagems = RTC_TEMP_AGE);
   uint8_t getType ();
   uint32_t getADCPin ();
   uint16_t getLocalYearOffset ();
@@ -198,8 +415,14 @@ public:
   bool onESP32 ();
   time_t doMakeTime (tmElements_t tminput);
   void doBreakTime (time_t &p_tinput, tmElements_t &p_tminout);
+  void breakTimes (const time_t *p_tinput, tmElements_t *p_tmoutput,
+                   size_t count);
+  void makeTimes (const tmElements_t *p_tminput, time_t *p_toutput,
+                  size_t count);
   bool isOperating ();
   float getRTCBattery (bool critical = false);
+  float getBatteryVoltage (bool force = false);
+  uint8_t getBatteryPercent ();
   void beginDrift (tmElements_t &p_tminput, bool internal = false);
   void pauseDrift (bool pause);
   void endDrift (tmElements_t &p_tminput, bool internal = false);
@@ -207,23 +430,97 @@ public:
   void setDrift (uint32_t Drift, bool isFast, bool internal = false);
   bool isFastDrift (bool internal = false);
   bool isNewMinute ();
+  uint32_t msToNewMinute ();
+  bool waitNewMinute (bool lightsleep = true);
   bool updatedDrift (bool internal = false);
   bool checkingDrift (bool internal = false);
   void use32K (bool active);
   bool using32K ();
+  void useSlew (bool active);
+  bool usingSlew ();
+  float getSlew (bool internal = false);
+  void setBusPins (int8_t sda, int8_t scl);
+  bool onFailover ();
+  void clearEvents ();
+  uint16_t eventBytes ();
+  void beginEvents (SmallRTCLogCursor &cursor);
+  bool nextEvent (SmallRTCLogCursor &cursor, time_t &t, uint8_t &code);
+  void dumpEvents (Print &out);
+  float getWakeCharge ();
+  double getTotalCharge ();
+  void clearCharge ();
+  void calibrateSlowClock ();
+  float getSlowClockFactor ();
+  bool readAsync (SmallRTCJob &job, tmElements_t &p_tmoutput,
+                  SmallRTCDone done = nullptr, void *arg = nullptr);
+  bool setAsync (SmallRTCJob &job, tmElements_t tminput,
+                 SmallRTCDone done = nullptr, void *arg = nullptr);
+  bool atMinuteWakeAsync (SmallRTCJob &job, uint8_t minute,
+                          bool enabled = true, SmallRTCDone done = nullptr,
+                          void *arg = nullptr);
+  bool waitAsync (SmallRTCJob &job, uint32_t timeoutms = portMAX_DELAY);
+  void beginMaintenance (uint32_t intervalms = 60000);
+  void endMaintenance ();
+  void getSnapshot (SmallRTCSnapshot &snap);
+  uint64_t monotonicMicros ();
+  static uint8_t crossCheck (SmallRTC *rtcs[], uint8_t count,
+                             tmElements_t &tm, uint8_t tolerance = 2);
+  bool setCalibration (int8_t offset);
+  int8_t getCalibration ();
 
 private:
-  void set (tmElements_t tm, bool enforce, bool internal);
+  bool set (tmElements_t tm, bool enforce, bool internal, time_t wake = 0);
+  bool _burstSet (time_t t, time_t &wake);
+  int64_t _slewFold ();
   void read (tmElements_t &tm, bool internal);
   void driftReset (time_t t, bool internal);
   void manageDrift (tmElements_t &tm, bool internal);
   void checkStatus (bool reset_op = false);
   void atMinuteWake (uint8_t hour, uint8_t minute, bool enabled = true);
   void setnewmin (uint8_t hrs, uint8_t mins, uint8_t secs);
-  bool _validateWakeup (int8_t &mins, int8_t &hours, tmElements_t &t_data,
-                        bool b_internal);
+  void _secondWake (tmElements_t &now, uint32_t seconds, bool enabled);
+  void _secondClear ();
+  bool _secondArmed ();
+  time_t _wakeTarget (time_t now, uint8_t hour, uint8_t minute);
+  void _epochWake (tmElements_t &now, time_t when, bool enabled);
+  bool _alarmAt (time_t r, time_t n, bool enabled);
+  double _driftError (time_t t, bool internal);
+  time_t _toRTCTime (time_t t, bool internal);
+  uint64_t _scaleSleep (uint64_t us);
+  void _timerArm (uint64_t us);
+  void _timerDisarm ();
+  float _batterySample ();
+  bool _queueJob (SmallRTCJob &job, uint8_t op, SmallRTCDone done, void *arg);
+  static void _asyncWorker (void *p);
+  static bool _startWorker ();
+  void _publish (tmElements_t &tm);
+  void _logEvent (uint8_t code);
+  uint8_t _logDecode (uint16_t pos, uint8_t &code, int32_t &delta);
+  bool _busCheck ();
+  void _busCount (uint16_t bytes);
+  void _energyTally (uint32_t sleep);
+  void _busRecover ();
+  const srtcchip *_chip ();
+  bool _generic ();
+  void _chipProbe ();
+  void _chipInit (uint8_t rtctype);
+  uint8_t _busAddr ();
+  bool _busAck (uint8_t addr);
+  bool _readRegs (uint8_t reg, uint8_t *buf, uint8_t len);
+  bool _writeRegs (uint8_t reg, const uint8_t *buf, uint8_t len);
+  bool _busRead (tmElements_t &tm);
+  bool _busWrite (tmElements_t &tm);
+  bool _busAlarm (uint8_t hour, uint8_t minute, bool enabled, bool clearonly);
+  bool _eeOffset (int8_t offset);
+  bool _eeIdle ();
   String _getValue (String data, char separator, int index);
   timespec tv;
+  __srtcsto *_sto; // This instance's state, normally _ssrtc.
+  TwoWire *_wire;  // Bus the RTC is on.
+  uint8_t _addr;   // RTC address, 0 to detect.
+  SmallRTCSnapshot _snap;     // Last published state, see getSnapshot.
+  std::atomic<uint32_t> _seq; // Odd while _snap is being written.
+  portMUX_TYPE _snapmux;      // Keeps writers on both cores apart.
 };
 
 extern __srtcsto _ssrtc;
@@ -0,0 +1,1358 @@
+/* Virtual Watchy for the SmallRTC simulator, see simhal.h.
+ *
+ * The ESP32's slow clock is counted the way ESP-IDF does: ticks of the real
+ * oscillator converted with the period calibrated at boot, so its error is
+ * how far the oscillator has moved since (plus the 40MHz crystal the
+ * calibration is measured against).  The RTCs are register models: their
+ * time is kept in the BCD registers and ticked like the chip does, alarms
+ * and the PCF8563 countdown are checked on each tick, flags are ANDed on
+ * write as the datasheets say.
+ */
+
+#include "simhal.h"
+
+#include <DS3232RTC.h>
+#include <Rtc_Pcf8563.h>
+#include <Wire.h>
+#include "esp_chip_info.h"
+#include "esp_private/esp_clk.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "soc/rtc.h"
+
+#define SIM_DS_ADDR 0x68
+#define SIM_PCF_ADDR 0x51
+#define SIM_XTAL_US (1000000.0 / 32768.0)
+#define SIM_RC_US (1000000.0 / 150000.0)
+#define SIM_STEP 600.0 // Longest step (seconds) so the temperature follows.
+#define SIM_ADJ_RATE 6 // adjtime slews 1us for every 6us.
+
+static simconfig _cfg;
+static bool _verbose = false;
+static double _el;      // True seconds since the start.
+static double _booted;  // _el at the last boot.
+static double _rtcus;   // esp_clk_rtc_time.
+static double _calppm;  // Slow clock error the boot calibration measured.
+static double _rtoff;   // CLOCK_REALTIME minus _rtcus (microseconds).
+static double _adjleft; // adjtime still to slew (microseconds).
+static bool _timeron;
+static double _timerat; // _rtcus the timer wake is for.
+static bool _ext0on;
+static bool _on32k;
+static uint64_t _rng;
+static simbus _bus;
+
+TwoWire Wire;
+TwoWire Wire1;
+
+static uint8_t
+_bcd (uint8_t v)
+{
+  return ((v / 10) << 4) | (v % 10);
+}
+
+static uint8_t
+_dec (uint8_t v)
+{
+  return ((v >> 4) * 10) + (v & 0x0F);
+}
+
+static double
+_random ()
+{
+  _rng ^= _rng >> 12;
+  _rng ^= _rng << 25;
+  _rng ^= _rng >> 27;
+  return ((_rng * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double
+_gauss ()
+{
+  double u = _random ();
+  return sqrt (-2.0 * log (u > 0 ? u : 1e-12)) * cos (2.0 * M_PI * _random ());
+}
+
+static double
+_ppm (const simosc &o, double t)
+{
+  return o.ppm + o.tempco * (t - 25.0)
+         + o.curve * (t - o.turnover) * (t - o.turnover);
+}
+
+static uint8_t
+_monthDays (uint8_t month, uint8_t year)
+{
+  static const uint8_t d[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  return (month == 2 && !(year % 4)) ? 29 : d[(month - 1) % 12];
+}
+
+// A chip on Wire with its own oscillator, the register pointer wraps at size.
+class simdev
+{
+public:
+  simdev (uint8_t addr, uint8_t size) : _addr (addr), _size (size) {}
+  virtual ~simdev () {}
+  uint8_t
+  addr ()
+  {
+    return _addr;
+  }
+  void
+  transmit (const uint8_t *b, uint8_t n)
+  {
+    _ptr = b[0] % _size;
+    if (n > 1)
+      {
+        store (_ptr, b + 1, n - 1);
+        _ptr = (_ptr + n - 1) % _size;
+      }
+  }
+  void
+  receive (uint8_t *b, uint8_t n)
+  {
+    for (uint8_t i = 0; i < n; i++)
+      {
+        b[i] = load (_ptr);
+        _ptr = (_ptr + 1) % _size;
+      }
+  }
+  // Runs the oscillator for dt true seconds, ticking the chip on each edge.
+  void
+  advance (double dt, double t)
+  {
+    _frac += dt * (1.0 + rate (t) * 1e-6);
+    while (_frac >= 1.0)
+      {
+        _frac -= 1.0;
+        tick ();
+      }
+  }
+  double
+  untilTick (double t)
+  {
+    return (1.0 - _frac) / (1.0 + rate (t) * 1e-6);
+  }
+  virtual bool intLow () = 0;
+
+protected:
+  virtual double
+  rate (double t)
+  {
+    return _ppm (_cfg.rtc, t);
+  }
+  virtual uint8_t load (uint8_t reg) = 0;
+  virtual void store (uint8_t reg, const uint8_t *b, uint8_t n) = 0;
+  virtual void tick () = 0;
+  uint8_t _r[0x20] = { 0 };
+  double _frac = 0.5;
+
+private:
+  uint8_t _addr;
+  uint8_t _size;
+  uint8_t _ptr = 0;
+};
+
+class simds3231 : public simdev
+{
+public:
+  simds3231 () : simdev (SIM_DS_ADDR, 0x13)
+  {
+    _r[0x04] = 0x01; // 2000-01-01, a saturday.
+    _r[0x05] = 0x01;
+    _r[0x03] = 0x07;
+    _r[0x0E] = 0x1C;
+    _r[0x0F] = 0x88; // Oscillator stopped, 32kHz on.
+  }
+  bool
+  intLow () override
+  {
+    return (_r[0x0E] & _BV (2)) && (_r[0x0F] & _r[0x0E] & 0x03);
+  }
+
+protected:
+  double
+  rate (double t) override
+  { // Aging is about 0.1ppm a step, positive slows it.
+    return simdev::rate (t) - 0.1 * (int8_t)_r[0x10];
+  }
+  uint8_t
+  load (uint8_t reg) override
+  {
+    if (reg == 0x11 || reg == 0x12)
+      {
+        int16_t q = (int16_t)floor (simTemp () * 4.0);
+        _r[0x11] = (uint8_t)(int8_t)(q >> 2);
+        _r[0x12] = (q & 3) << 6;
+      }
+    return _r[reg];
+  }
+  void
+  store (uint8_t reg, const uint8_t *b, uint8_t n) override
+  {
+    for (uint8_t i = 0; i < n; i++, reg = (reg + 1) % 0x13)
+      {
+        if (reg == 0x00)
+          { // Writing the seconds restarts the countdown chain.
+            _frac = 0;
+          }
+        if (reg == 0x0F)
+          { // OSF and the alarm flags can only be cleared.
+            _r[reg] = (_r[reg] & b[i] & 0x83) | (b[i] & 0x08);
+          }
+        else if (reg != 0x11 && reg != 0x12)
+          {
+            _r[reg] = b[i];
+          }
+      }
+  }
+  void
+  tick () override
+  {
+    uint8_t s = _dec (_r[0]) + 1, m, h, d, mo, y;
+    if (s < 60)
+      {
+        _r[0] = _bcd (s);
+      }
+    else
+      {
+        _r[0] = 0;
+        m = _dec (_r[1]) + 1;
+        _r[1] = _bcd (m % 60);
+        if (m == 60)
+          {
+            h = _dec (_r[2] & 0x3F) + 1;
+            _r[2] = _bcd (h % 24);
+            if (h == 24)
+              {
+                _r[3] = (_r[3] % 7) + 1;
+                d = _dec (_r[4]) + 1;
+                mo = _dec (_r[5] & 0x1F);
+                y = _dec (_r[6]);
+                if (d > _monthDays (mo, y))
+                  {
+                    d = 1;
+                    if (++mo > 12)
+                      {
+                        mo = 1;
+                        if (++y > 99)
+                          {
+                            y = 0;
+                            _r[5] ^= 0x80;
+                          }
+                        _r[6] = _bcd (y);
+                      }
+                    _r[5] = (_r[5] & 0x80) | _bcd (mo);
+                  }
+                _r[4] = _bcd (d);
+              }
+          }
+      }
+    if (match (0x07, true))
+      {
+        _r[0x0F] |= _BV (0);
+      }
+    if (!_r[0] && match (0x0B, false))
+      {
+        _r[0x0F] |= _BV (1);
+      }
+  }
+
+private:
+  // Alarm 1 starts at the seconds, alarm 2 at the minutes, bit 7 masks.
+  bool
+  match (uint8_t a, bool secs)
+  {
+    uint8_t t = 0, dd;
+    if (secs)
+      {
+        if (!(_r[a] & 0x80) && (_r[a] & 0x7F) != _r[0])
+          {
+            return false;
+          }
+        t = 1;
+      }
+    if (!(_r[a + t] & 0x80) && (_r[a + t] & 0x7F) != _r[1])
+      {
+        return false;
+      }
+    if (!(_r[a + t + 1] & 0x80) && (_r[a + t + 1] & 0x3F) != _r[2])
+      {
+        return false;
+      }
+    dd = _r[a + t + 2];
+    if (dd & 0x80)
+      {
+        return true;
+      }
+    return (dd & 0x40) ? (dd & 0x0F) == _r[3] : (dd & 0x3F) == _r[4];
+  }
+};
+
+class simpcf8563 : public simdev
+{
+public:
+  simpcf8563 () : simdev (SIM_PCF_ADDR, 0x10)
+  {
+    _r[0x02] = 0x80; // Voltage low, 2000-01-01.
+    _r[0x05] = 0x01;
+    _r[0x06] = 0x06;
+    _r[0x07] = 0x01;
+    _r[0x09] = _r[0x0A] = _r[0x0B] = _r[0x0C] = 0x80;
+    _r[0x0E] = 0x03;
+  }
+  bool
+  intLow () override
+  {
+    bool p = _pulse;
+    _pulse = false;
+    return p || ((_r[1] & _BV (3)) && (_r[1] & _BV (1)))
+           || ((_r[1] & _BV (2)) && (_r[1] & _BV (0)) && !(_r[1] & _BV (4)));
+  }
+
+protected:
+  uint8_t
+  load (uint8_t reg) override
+  {
+    return (reg == 0x0F) ? _count : _r[reg];
+  }
+  void
+  store (uint8_t reg, const uint8_t *b, uint8_t n) override
+  {
+    for (uint8_t i = 0; i < n; i++, reg = (reg + 1) % 0x10)
+      {
+        if (reg == 0x00 && (_r[0] & _BV (5)) && !(b[i] & _BV (5)))
+          { // Released from STOP, the first second is about half of one.
+            _frac = 0.49;
+          }
+        if (reg == 0x01)
+          { // AF and TF are ANDed so one can be cleared without the other.
+            _r[1] = (_r[1] & b[i] & 0x0C) | (b[i] & 0x13);
+          }
+        else
+          {
+            _r[reg] = b[i];
+          }
+        if (reg == 0x0F)
+          {
+            _count = b[i];
+          }
+      }
+  }
+  void
+  tick () override
+  {
+    uint8_t s, m, h, d, mo, y;
+    if (_r[0] & _BV (5))
+      {
+        return;
+      }
+    s = _dec (_r[2] & 0x7F) + 1;
+    _r[2] = (_r[2] & 0x80) | _bcd (s % 60);
+    if (s == 60)
+      {
+        m = _dec (_r[3] & 0x7F) + 1;
+        _r[3] = _bcd (m % 60);
+        if (m == 60)
+          {
+            h = _dec (_r[4] & 0x3F) + 1;
+            _r[4] = _bcd (h % 24);
+            if (h == 24)
+              {
+                _r[6] = ((_r[6] & 0x07) + 1) % 7;
+                d = _dec (_r[5] & 0x3F) + 1;
+                mo = _dec (_r[7] & 0x1F);
+                y = _dec (_r[8]);
+                if (d > _monthDays (mo, y))
+                  {
+                    d = 1;
+                    if (++mo > 12)
+                      {
+                        mo = 1;
+                        if (++y > 99)
+                          {
+                            y = 0;
+                            _r[7] ^= 0x80;
+                          }
+                        _r[8] = _bcd (y);
+                      }
+                    _r[7] = (_r[7] & 0x80) | _bcd (mo);
+                  }
+                _r[5] = _bcd (d);
+              }
+          }
+        if (alarm ())
+          {
+            _r[1] |= _BV (3);
+          }
+      }
+    // The countdown's 1Hz and 1/60Hz sources are the same divider chain, so
+    // its first period is whatever is left of the current one.
+    if ((_r[0x0E] & _BV (7))
+        && ((_r[0x0E] & 0x03) == 0x02
+            || ((_r[0x0E] & 0x03) == 0x03 && s == 60))
+        && _count && !--_count)
+      {
+        _r[1] |= _BV (2);
+        _pulse = (_r[1] & _BV (4)) && (_r[1] & _BV (0));
+        _count = _r[0x0F];
+      }
+  }
+
+private:
+  bool
+  alarm ()
+  {
+    static const uint8_t regs[] = { 0x03, 0x04, 0x05, 0x06 };
+    static const uint8_t masks[] = { 0x7F, 0x3F, 0x3F, 0x07 };
+    bool any = false;
+    for (uint8_t i = 0; i < 4; i++)
+      {
+        if (!(_r[0x09 + i] & 0x80))
+          {
+            if ((_r[0x09 + i] & masks[i]) != (_r[regs[i]] & masks[i]))
+              {
+                return false;
+              }
+            any = true;
+          }
+      }
+    return any;
+  }
+  uint8_t _count = 0;
+  bool _pulse = false;
+};
+
+static simdev *_dev = NULL;
+
+static double
+_slowPpm (double t)
+{
+  return _ppm (_cfg.slow, t);
+}
+
+// What a calibration of the slow clock measures now (ppm).
+static double
+_calMeasure ()
+{
+  return _slowPpm (simTemp ()) - _cfg.mainppm + _cfg.calnoise * _gauss ();
+}
+
+static uint32_t
+_calValue (double ppm)
+{
+  double p = (_cfg.xtal32k ? SIM_XTAL_US : SIM_RC_US) / (1.0 + ppm * 1e-6);
+  return (uint32_t)llround (p * (1 << 19));
+}
+
+// Moves everything on by dt true seconds.
+static void
+_step (double dt)
+{
+  double t = simTemp (), us = dt * 1e6, a;
+  _rtcus += us * (1.0 + _slowPpm (t) * 1e-6) / (1.0 + _calppm * 1e-6);
+  if (_adjleft != 0)
+    {
+      a = fmin (fabs (_adjleft), us / SIM_ADJ_RATE);
+      a = (_adjleft > 0) ? a : -a;
+      _rtoff += a;
+      _adjleft -= a;
+    }
+  if (_dev)
+    {
+      _dev->advance (dt, t);
+    }
+  _el += dt;
+}
+
+static uint8_t
+_sleep (double maxs)
+{
+  double end = _el + maxs, dt, r;
+  for (;;)
+    {
+      if (_ext0on && _dev && _dev->intLow ())
+        {
+          return SIM_WAKE_EXT0;
+        }
+      if (_timeron && _rtcus >= _timerat - 0.5)
+        {
+          return SIM_WAKE_TIMER;
+        }
+      dt = fmin (end - _el, SIM_STEP);
+      if (dt <= 0)
+        {
+          return SIM_WAKE_NONE;
+        }
+      if (_timeron)
+        {
+          r = (1.0 + _slowPpm (simTemp ()) * 1e-6) / (1.0 + _calppm * 1e-6);
+          dt = fmin (dt, (_timerat - _rtcus) / r / 1e6 + 1e-7);
+        }
+      if (_ext0on && _dev)
+        {
+          dt = fmin (dt, _dev->untilTick (simTemp ()) + 1e-7);
+        }
+      _step (dt);
+    }
+}
+
+static void
+_wait (double us)
+{
+  double s = us / 1e6;
+  while (s > 0)
+    {
+      _step (fmin (s, SIM_STEP));
+      s -= SIM_STEP;
+    }
+}
+
+static void
+_boot ()
+{
+  _booted = _el;
+  _timeron = false;
+  _ext0on = false;
+  _adjleft = 0; // Not kept in RTC memory.
+  _calppm = _calMeasure ();
+  _wait (30000); // Bootloader and app start.
+}
+
+void
+simReset (const simconfig &cfg)
+{
+  delete _dev;
+  _cfg = cfg;
+  _rng = cfg.seed * 2654435761ULL + 1;
+  _el = 0;
+  _rtcus = 0;
+  _rtoff = 0;
+  _on32k = false;
+  _bus = simbus ();
+  _dev = (cfg.chip == SIM_DS3231)    ? (simdev *)new simds3231 ()
+         : (cfg.chip == SIM_PCF8563) ? (simdev *)new simpcf8563 ()
+                                     : NULL;
+  _boot ();
+}
+
+double
+simTrue ()
+{
+  return (double)_cfg.start + _el;
+}
+
+double
+simTemp ()
+{
+  return _cfg.tempmean + _cfg.tempday * sin (2.0 * M_PI * _el / 86400.0)
+         + _cfg.tempyear * sin (2.0 * M_PI * _el / 31557600.0);
+}
+
+void
+simAdvance (double us)
+{
+  _wait (us);
+}
+
+uint8_t
+simDeepSleep (double maxs)
+{
+  uint8_t w = _sleep (maxs);
+  _boot ();
+  return w;
+}
+
+int64_t
+simRealtimeUs ()
+{
+  return (int64_t)llround (_rtoff + _rtcus);
+}
+
+simbus
+simBus ()
+{
+  return _bus;
+}
+
+void
+simVerbose (bool on)
+{
+  _verbose = on;
+}
+
+void
+simLog (char level, const char *format, ...)
+{
+  va_list a;
+  if (!_verbose && level != 'E')
+    {
+      return;
+    }
+  va_start (a, format);
+  printf ("%12.3f %c ", _el, level);
+  vprintf (format, a);
+  printf ("\n");
+  va_end (a);
+}
+
+// TimeLib, as in the Arduino library.
+
+#define SIM_LEAP(Y)                                                           \
+  (((1970 + (Y)) > 0) && !((1970 + (Y)) % 4)                                  \
+   && (((1970 + (Y)) % 100) || !((1970 + (Y)) % 400)))
+
+static const uint8_t _days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30,
+                                 31 };
+
+time_t
+makeTime (const tmElements_t &tm)
+{
+  time_t s = tm.Year * (86400L * 365);
+  int i;
+  for (i = 0; i < tm.Year; i++)
+    {
+      if (SIM_LEAP (i))
+        {
+          s += 86400L;
+        }
+    }
+  for (i = 1; i < tm.Month; i++)
+    {
+      s += 86400L * ((i == 2 && SIM_LEAP (tm.Year)) ? 29 : _days[i - 1]);
+    }
+  s += (tm.Day - 1) * 86400L + tm.Hour * 3600L + tm.Minute * 60L + tm.Second;
+  return s;
+}
+
+void
+breakTime (time_t t, tmElements_t &tm)
+{
+  uint32_t time = (uint32_t)t, days = 0;
+  uint8_t year = 0, month, len;
+  tm.Second = time % 60;
+  time /= 60;
+  tm.Minute = time % 60;
+  time /= 60;
+  tm.Hour = time % 24;
+  time /= 24;
+  tm.Wday = ((time + 4) % 7) + 1;
+  while ((unsigned)(days += (SIM_LEAP (year) ? 366 : 365)) <= time)
+    {
+      year++;
+    }
+  tm.Year = year;
+  days -= SIM_LEAP (year) ? 366 : 365;
+  time -= days;
+  for (month = 0; month < 12; month++)
+    {
+      len = (month == 1 && SIM_LEAP (year)) ? 29 : _days[month];
+      if (time < len)
+        {
+          break;
+        }
+      time -= len;
+    }
+  tm.Month = month + 1;
+  tm.Day = time + 1;
+}
+
+// Arduino and ESP-IDF.
+
+unsigned long
+millis ()
+{
+  return (unsigned long)(esp_timer_get_time () / 1000);
+}
+
+void
+delay (uint32_t ms)
+{
+  _wait (ms * 1000.0);
+}
+
+void
+delayMicroseconds (uint32_t us)
+{
+  _wait (us);
+}
+
+uint32_t
+analogReadMilliVolts (uint8_t pin)
+{ // The battery, halved by the divider, on the pin each board has it on.
+  uint8_t b = (_cfg.chip == SIM_DS3231)    ? 33
+              : (_cfg.chip == SIM_PCF8563) ? 34
+              : (_cfg.xtal32k)             ? 9
+                                           : 0;
+  return (b && pin == b) ? (uint32_t)(2000 + 8.0 * _gauss ()) : 0;
+}
+
+void
+pinMode (uint8_t pin, uint8_t mode)
+{
+}
+
+void
+digitalWrite (uint8_t pin, uint8_t val)
+{
+}
+
+int
+digitalRead (uint8_t pin)
+{
+  return HIGH; // Nothing holds the bus.
+}
+
+float
+temperatureRead ()
+{
+  return (float)(simTemp () + 8.0);
+}
+
+size_t
+Print::printf (const char *format, ...)
+{
+  char b[128];
+  va_list a;
+  int n;
+  va_start (a, format);
+  n = vsnprintf (b, sizeof (b), format, a);
+  va_end (a);
+  for (int i = 0; i < n && i < (int)sizeof (b) - 1; i++)
+    {
+      write ((uint8_t)b[i]);
+    }
+  return n;
+}
+
+void
+esp_chip_info (esp_chip_info_t *info)
+{
+  info->model = (!_dev && _cfg.xtal32k) ? CHIP_ESP32S3 : CHIP_ESP32;
+}
+
+int64_t
+esp_timer_get_time ()
+{ // Counted on the 40MHz crystal from boot.
+  return (int64_t)((_el - _booted) * 1e6 * (1.0 + _cfg.mainppm * 1e-6));
+}
+
+uint64_t
+esp_clk_rtc_time ()
+{
+  return (uint64_t)_rtcus;
+}
+
+uint32_t
+esp_clk_slowclk_cal_get ()
+{
+  return _calValue (_calppm);
+}
+
+uint32_t
+rtc_clk_cal (rtc_cal_sel_t sel, uint32_t cycles)
+{
+  double p = (_cfg.xtal32k ? SIM_XTAL_US : SIM_RC_US);
+  _wait (cycles * p);
+  return _calValue (_calMeasure ());
+}
+
+void
+rtc_clk_32k_enable (bool enable)
+{
+  _on32k = enable && _cfg.xtal32k;
+}
+
+bool
+rtc_clk_32k_enabled ()
+{
+  return _on32k;
+}
+
+esp_err_t
+esp_sleep_enable_timer_wakeup (uint64_t us)
+{
+  _timeron = true;
+  _timerat = _rtcus + us;
+  return ESP_OK;
+}
+
+esp_err_t
+esp_sleep_enable_ext0_wakeup (gpio_num_t pin, int level)
+{
+  _ext0on = true;
+  return ESP_OK;
+}
+
+esp_err_t
+esp_sleep_disable_wakeup_source (esp_sleep_source_t source)
+{
+  if (source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL)
+    {
+      _timeron = false;
+    }
+  if (source == ESP_SLEEP_WAKEUP_EXT0 || source == ESP_SLEEP_WAKEUP_ALL)
+    {
+      _ext0on = false;
+    }
+  return ESP_OK;
+}
+
+esp_err_t
+esp_light_sleep_start ()
+{
+  _sleep (86400.0);
+  return ESP_OK;
+}
+
+// The ESP32's clock, the library's calls are linked here by --wrap.
+
+extern "C"
+{
+  int
+  __wrap_gettimeofday (struct timeval *tv, void *tz)
+  {
+    int64_t us = simRealtimeUs ();
+    tv->tv_sec = (time_t)(us / 1000000);
+    tv->tv_usec = (suseconds_t)(us % 1000000);
+    return 0;
+  }
+
+  int
+  __wrap_settimeofday (const struct timeval *tv, const void *tz)
+  {
+    _rtoff = tv->tv_sec * 1e6 + tv->tv_usec - _rtcus;
+    _adjleft = 0;
+    return 0;
+  }
+
+  int
+  __wrap_clock_gettime (clockid_t clk, struct timespec *ts)
+  {
+    int64_t us = simRealtimeUs ();
+    ts->tv_sec = (time_t)(us / 1000000);
+    ts->tv_nsec = (long)(us % 1000000) * 1000;
+    return 0;
+  }
+
+  int
+  __wrap_clock_settime (clockid_t clk, const struct timespec *ts)
+  {
+    _rtoff = ts->tv_sec * 1e6 + ts->tv_nsec / 1000 - _rtcus;
+    _adjleft = 0;
+    return 0;
+  }
+
+  int
+  __wrap_adjtime (const struct timeval *delta, struct timeval *olddelta)
+  {
+    if (olddelta)
+      {
+        olddelta->tv_sec = (time_t)(_adjleft / 1e6);
+        olddelta->tv_usec = (suseconds_t)fmod (_adjleft, 1e6);
+      }
+    if (delta)
+      {
+        _adjleft = delta->tv_sec * 1e6 + delta->tv_usec;
+      }
+    return 0;
+  }
+}
+
+// FreeRTOS, there is only the one task.
+
+BaseType_t
+xTaskCreate (TaskFunction_t task, const char *name, uint32_t stack, void *arg,
+             uint32_t priority, TaskHandle_t *handle)
+{
+  return pdFAIL;
+}
+
+void
+vTaskDelay (TickType_t ticks)
+{
+  _wait (ticks * 1000.0);
+}
+
+QueueHandle_t
+xQueueCreate (uint32_t length, uint32_t size)
+{
+  return NULL;
+}
+
+BaseType_t
+xQueueSend (QueueHandle_t queue, const void *item, TickType_t wait)
+{
+  return pdFALSE;
+}
+
+BaseType_t
+xQueueReceive (QueueHandle_t queue, void *item, TickType_t wait)
+{
+  return pdFALSE;
+}
+
+void
+vQueueDelete (QueueHandle_t queue)
+{
+}
+
+SemaphoreHandle_t
+xSemaphoreCreateRecursiveMutex ()
+{
+  static int m;
+  return &m;
+}
+
+BaseType_t
+xSemaphoreTakeRecursive (SemaphoreHandle_t mutex, TickType_t wait)
+{
+  return pdTRUE;
+}
+
+BaseType_t
+xSemaphoreGiveRecursive (SemaphoreHandle_t mutex)
+{
+  return pdTRUE;
+}
+
+// Wire, only Wire has the RTC on it.  Each byte (and the address) takes nine
+// clocks of bus time.
+
+static bool
+_busUp (TwoWire *w, uint8_t addr, uint8_t n)
+{
+  _bus.trans++;
+  _wait ((n + 1) * 9.0 * 1e6 / w->getClock ());
+  if (w != &Wire || !_dev || _dev->addr () != addr
+      || _random () < _cfg.nack)
+    {
+      _bus.nacks++;
+      simLog ('D', "sim: no ACK from 0x%02X", addr);
+      return false;
+    }
+  return true;
+}
+
+bool
+TwoWire::begin ()
+{
+  return true;
+}
+
+bool
+TwoWire::begin (int sda, int scl, uint32_t frequency)
+{
+  _clock = (frequency ? frequency : 100000); // As Arduino-ESP32 does.
+  return true;
+}
+
+bool
+TwoWire::end ()
+{
+  return true;
+}
+
+bool
+TwoWire::setClock (uint32_t frequency)
+{
+  _clock = frequency;
+  return true;
+}
+
+uint32_t
+TwoWire::getClock ()
+{
+  return _clock;
+}
+
+void
+TwoWire::setTimeOut (uint16_t timeoutms)
+{
+  _timeout = timeoutms;
+}
+
+uint16_t
+TwoWire::getTimeOut ()
+{
+  return _timeout;
+}
+
+void
+TwoWire::beginTransmission (uint16_t address)
+{
+  _addr = (uint8_t)address;
+  _txlen = 0;
+}
+
+uint8_t
+TwoWire::endTransmission (bool sendstop)
+{
+  if (!_busUp (this, _addr, _txlen))
+    {
+      return 2;
+    }
+  _bus.bytes += _txlen;
+  if (_txlen)
+    {
+      _dev->transmit (_tx, _txlen);
+    }
+  return 0;
+}
+
+uint8_t
+TwoWire::requestFrom (uint8_t address, uint8_t len)
+{
+  _rxlen = _rxpos = 0;
+  len = (len > sizeof (_rx)) ? sizeof (_rx) : len;
+  if (!_busUp (this, address, len))
+    {
+      return 0;
+    }
+  _bus.bytes += len;
+  _dev->receive (_rx, len);
+  _rxlen = len;
+  return len;
+}
+
+size_t
+TwoWire::write (uint8_t data)
+{
+  if (_txlen >= sizeof (_tx))
+    {
+      return 0;
+    }
+  _tx[_txlen++] = data;
+  return 1;
+}
+
+size_t
+TwoWire::write (const uint8_t *data, size_t len)
+{
+  size_t i;
+  for (i = 0; i < len && write (data[i]); i++)
+    {
+    }
+  return i;
+}
+
+int
+TwoWire::available ()
+{
+  return _rxlen - _rxpos;
+}
+
+int
+TwoWire::read ()
+{
+  return (_rxpos < _rxlen) ? _rx[_rxpos++] : -1;
+}
+
+// DS3232RTC, register by register as the library does it.
+
+uint8_t
+DS3232RTC::read (tmElements_t &tm)
+{
+  Wire.beginTransmission (SIM_DS_ADDR);
+  Wire.write ((uint8_t)0x00);
+  if (Wire.endTransmission () || Wire.requestFrom (SIM_DS_ADDR, 7) != 7)
+    {
+      return 1;
+    }
+  tm.Second = _dec (Wire.read () & 0x7F);
+  tm.Minute = _dec (Wire.read ());
+  tm.Hour = _dec (Wire.read () & 0x3F);
+  tm.Wday = Wire.read () & 0x07;
+  tm.Day = _dec (Wire.read ());
+  tm.Month = _dec (Wire.read () & 0x1F);
+  tm.Year = y2kYearToTm (_dec (Wire.read ()));
+  return 0;
+}
+
+uint8_t
+DS3232RTC::write (tmElements_t &tm)
+{
+  uint8_t s;
+  Wire.beginTransmission (SIM_DS_ADDR);
+  Wire.write ((uint8_t)0x00);
+  Wire.write (_bcd (tm.Second));
+  Wire.write (_bcd (tm.Minute));
+  Wire.write (_bcd (tm.Hour));
+  Wire.write (tm.Wday);
+  Wire.write (_bcd (tm.Day));
+  Wire.write (_bcd (tm.Month));
+  Wire.write (_bcd (tmYearToY2k (tm.Year)));
+  if ((s = Wire.endTransmission ()))
+    {
+      return s;
+    }
+  s = readRTC (0x0F);
+  writeRTC (0x0F, s & ~_BV (7));
+  return 0;
+}
+
+uint8_t
+DS3232RTC::readRTC (uint8_t addr)
+{
+  Wire.beginTransmission (SIM_DS_ADDR);
+  Wire.write (addr);
+  if (Wire.endTransmission () || Wire.requestFrom (SIM_DS_ADDR, 1) != 1)
+    {
+      return 0;
+    }
+  return Wire.read ();
+}
+
+uint8_t
+DS3232RTC::writeRTC (uint8_t addr, uint8_t value)
+{
+  Wire.beginTransmission (SIM_DS_ADDR);
+  Wire.write (addr);
+  Wire.write (value);
+  return Wire.endTransmission ();
+}
+
+void
+DS3232RTC::setAlarm (ALARM_TYPES_t type, uint8_t seconds, uint8_t minutes,
+                     uint8_t hours, uint8_t daydate)
+{
+  uint8_t a;
+  seconds = _bcd (seconds);
+  minutes = _bcd (minutes);
+  hours = _bcd (hours);
+  daydate = _bcd (daydate);
+  seconds |= (type & 0x01) ? 0x80 : 0;
+  minutes |= (type & 0x02) ? 0x80 : 0;
+  hours |= (type & 0x04) ? 0x80 : 0;
+  daydate |= ((type & 0x08) ? 0x80 : 0) | ((type & 0x10) ? 0x40 : 0);
+  if (!(type & 0x80))
+    {
+      a = 0x07;
+      writeRTC (a++, seconds);
+    }
+  else
+    {
+      a = 0x0B;
+    }
+  writeRTC (a++, minutes);
+  writeRTC (a++, hours);
+  writeRTC (a, daydate);
+}
+
+void
+DS3232RTC::setAlarm (ALARM_TYPES_t type, uint8_t minutes, uint8_t hours,
+                     uint8_t daydate)
+{
+  setAlarm (type, 0, minutes, hours, daydate);
+}
+
+void
+DS3232RTC::alarmInterrupt (uint8_t alarm, bool enable)
+{
+  uint8_t c = readRTC (0x0E), m = _BV (alarm - 1);
+  writeRTC (0x0E, enable ? (c | m) : (c & ~m));
+}
+
+bool
+DS3232RTC::alarm (uint8_t alarm)
+{
+  uint8_t s = readRTC (0x0F), m = _BV (alarm - 1);
+  if (s & m)
+    {
+      writeRTC (0x0F, s & ~m);
+      return true;
+    }
+  return false;
+}
+
+void
+DS3232RTC::clearAlarm (uint8_t alarm)
+{
+  uint8_t s = readRTC (0x0F);
+  writeRTC (0x0F, s & ~_BV (alarm - 1));
+}
+
+void
+DS3232RTC::squareWave (SQWAVE_FREQS_t freq)
+{
+  uint8_t c = readRTC (0x0E);
+  if (freq >= SQWAVE_NONE)
+    {
+      c |= _BV (2);
+    }
+  else
+    {
+      c = (c & 0xE3) | (freq << 3);
+    }
+  writeRTC (0x0E, c);
+}
+
+int16_t
+DS3232RTC::temperature ()
+{
+  uint8_t h, l;
+  Wire.beginTransmission (SIM_DS_ADDR);
+  Wire.write ((uint8_t)0x11);
+  if (Wire.endTransmission () || Wire.requestFrom (SIM_DS_ADDR, 2) != 2)
+    {
+      return 0;
+    }
+  h = Wire.read ();
+  l = Wire.read ();
+  return (int16_t)(((int8_t)h << 2) | (l >> 6));
+}
+
+bool
+DS3232RTC::oscStopped (bool clear)
+{
+  uint8_t s = readRTC (0x0F);
+  bool r = s & _BV (7);
+  if (r && clear)
+    {
+      writeRTC (0x0F, s & ~_BV (7));
+    }
+  return r;
+}
+
+// Rtc_Pcf8563, each getter reads the time registers again.
+
+static void
+_pcfWrite (uint8_t reg, const uint8_t *b, uint8_t n)
+{
+  Wire.beginTransmission (SIM_PCF_ADDR);
+  Wire.write (reg);
+  Wire.write (b, n);
+  Wire.endTransmission ();
+}
+
+static uint8_t
+_pcfRead (uint8_t reg)
+{
+  Wire.beginTransmission (SIM_PCF_ADDR);
+  Wire.write (reg);
+  if (Wire.endTransmission () || Wire.requestFrom (SIM_PCF_ADDR, 1) != 1)
+    {
+      return 0;
+    }
+  return Wire.read ();
+}
+
+void
+Rtc_Pcf8563::getDateTime ()
+{
+  Wire.beginTransmission (SIM_PCF_ADDR);
+  Wire.write ((uint8_t)0x02);
+  if (Wire.endTransmission () || Wire.requestFrom (SIM_PCF_ADDR, 7) != 7)
+    {
+      memset (_regs, 0, sizeof (_regs));
+      return;
+    }
+  for (uint8_t i = 0; i < 7; i++)
+    {
+      _regs[i] = Wire.read ();
+    }
+}
+
+void
+Rtc_Pcf8563::clearStatus ()
+{
+  uint8_t b[] = { 0x00, 0x00 };
+  _pcfWrite (0x00, b, 2);
+}
+
+void
+Rtc_Pcf8563::setDate (uint8_t day, uint8_t weekday, uint8_t month,
+                      uint8_t century, uint8_t year)
+{
+  uint8_t b[] = { _bcd (day), weekday, (uint8_t)(_bcd (month)
+                                                 | (century ? 0x80 : 0)),
+                  _bcd (year) };
+  _pcfWrite (0x05, b, 4);
+}
+
+void
+Rtc_Pcf8563::setTime (uint8_t hour, uint8_t minute, uint8_t sec)
+{
+  uint8_t b[] = { _bcd (sec), _bcd (minute), _bcd (hour) };
+  _pcfWrite (0x02, b, 3);
+}
+
+uint8_t
+Rtc_Pcf8563::getSecond ()
+{
+  getDateTime ();
+  return _dec (_regs[0] & 0x7F);
+}
+
+uint8_t
+Rtc_Pcf8563::getMinute ()
+{
+  getDateTime ();
+  return _dec (_regs[1] & 0x7F);
+}
+
+uint8_t
+Rtc_Pcf8563::getHour ()
+{
+  getDateTime ();
+  return _dec (_regs[2] & 0x3F);
+}
+
+uint8_t
+Rtc_Pcf8563::getDay ()
+{
+  getDateTime ();
+  return _dec (_regs[3] & 0x3F);
+}
+
+uint8_t
+Rtc_Pcf8563::getWeekday ()
+{
+  getDateTime ();
+  return _regs[4] & 0x07;
+}
+
+uint8_t
+Rtc_Pcf8563::getMonth ()
+{
+  getDateTime ();
+  return _dec (_regs[5] & 0x1F);
+}
+
+uint8_t
+Rtc_Pcf8563::getYear ()
+{
+  getDateTime ();
+  return _dec (_regs[6]);
+}
+
+void
+Rtc_Pcf8563::setAlarm (uint8_t minute, uint8_t hour, uint8_t day,
+                       uint8_t weekday)
+{
+  uint8_t b[] = { (uint8_t)(minute < 99 ? _bcd (minute) : 0x80),
+                  (uint8_t)(hour < 99 ? _bcd (hour) : 0x80),
+                  (uint8_t)(day < 99 ? _bcd (day) : 0x80),
+                  (uint8_t)(weekday < 99 ? weekday : 0x80) };
+  uint8_t s = _pcfRead (0x01);
+  _pcfWrite (0x09, b, 4);
+  s = (s & ~_BV (3)) | _BV (1) | _BV (2); // TF written as 1 is left alone.
+  _pcfWrite (0x01, &s, 1);
+}
+
+void
+Rtc_Pcf8563::clearAlarm ()
+{
+  uint8_t s = _pcfRead (0x01);
+  s = (s & ~(_BV (3) | _BV (1))) | _BV (2);
+  _pcfWrite (0x01, &s, 1);
+}
+
+void
+Rtc_Pcf8563::resetAlarm ()
+{
+  uint8_t b[] = { 0x80, 0x80, 0x80, 0x80 };
+  clearAlarm ();
+  _pcfWrite (0x09, b, 4);
+}
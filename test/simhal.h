@@ -0,0 +1,66 @@
+#ifndef SIMHAL_H
+#define SIMHAL_H
+
+/* Virtual Watchy for the SmallRTC simulator.
+ *
+ * Keeps the true time and runs everything SmallRTC can see from it: the
+ * ESP32's slow clock (what esp_clk_rtc_time, CLOCK_REALTIME and the deep sleep
+ * timer count with), its calibration, and a DS3231 or PCF8563 on Wire with
+ * its own oscillator, alarms, countdown and INT pin.  Each oscillator's error
+ * follows the temperature profile.  Time only moves when SmallRTC waits
+ * (delay, light sleep, I2C transfers) or the caller sleeps, so runs are
+ * repeatable for a given seed.
+ */
+
+#include <stdint.h>
+
+#define SIM_NONE 0 // ESP32-S3 board, no RTC on the bus.
+#define SIM_DS3231 1
+#define SIM_PCF8563 2
+
+#define SIM_WAKE_NONE 0 // Nothing armed that went off, woken by the cap.
+#define SIM_WAKE_TIMER 1
+#define SIM_WAKE_EXT0 2
+
+// Frequency error in ppm: ppm + tempco * (T - 25) + curve * (T - turnover)^2.
+struct simosc
+{
+  double ppm;
+  double tempco;
+  double curve;
+  double turnover;
+};
+
+struct simconfig
+{
+  uint8_t chip;       // SIM_ value for what is on Wire.
+  simosc rtc;         // The external RTC's oscillator.
+  bool xtal32k;       // ESP32 slow clock from the 32K crystal, else RC.
+  simosc slow;        // The ESP32's slow clock.
+  double mainppm;     // The ESP32's 40MHz crystal, calibration is against it.
+  double calnoise;    // Calibration scatter (ppm, one sigma).
+  double nack;        // Chance an I2C transaction isn't acknowledged.
+  double tempmean;    // Temperature profile (Celsius), daily and yearly
+  double tempday;     // swings are added as sines.
+  double tempyear;
+  int64_t start;      // True time the run starts at (UTC seconds).
+  uint32_t seed;
+};
+
+struct simbus
+{
+  uint64_t trans;  // Transactions, each endTransmission and requestFrom.
+  uint64_t bytes;  // Bytes after the address.
+  uint64_t nacks;  // Transactions that weren't acknowledged.
+};
+
+void simReset (const simconfig &cfg);
+double simTrue ();                 // True time (UTC seconds).
+double simTemp ();                 // Current temperature.
+void simAdvance (double us);       // Awake time passing.
+uint8_t simDeepSleep (double maxs); // Sleeps until a wake source, reboots.
+int64_t simRealtimeUs ();          // The ESP32's CLOCK_REALTIME.
+simbus simBus ();
+void simVerbose (bool on);
+
+#endif
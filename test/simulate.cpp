@@ -0,0 +1,240 @@
+/* SmallRTC time-warp simulator.
+ *
+ * Runs SmallRTC on the host against simhal's virtual Watchy: each strategy
+ * drives the loop a watch face does (clearAlarm, read, draw, nextMinuteWake,
+ * deep sleep) for the given number of simulated days and reports how far the
+ * time read was from the true time, how the wakes landed and what the bus and
+ * the battery saw.  Everything runs off a seeded generator, so a run can be
+ * repeated exactly.
+ *
+ *   make -C test            Builds and runs 30 days of every strategy.
+ *   test/simulate 730 7     Two years with seed 7.
+ *   test/simulate 1 1 -v    One day with SmallRTC's logging.
+ *
+ * SmallRTC.cpp is compiled in here so each deep sleep can reset its file
+ * statics and construct the object again, as a real boot does; the RTC
+ * memory (_ssrtc) is kept, it is only cleared for the first power up.
+ */
+
+#include "../src/SmallRTC.cpp"
+#include "simhal.h"
+#include <new>
+
+#define SIM_AWAKE_US 150000 // Reading the time and drawing the screen.
+#define SIM_START 1772323200 // 2026-03-01 00:00:00 UTC.
+#define SIM_BUTTON 3600.0 // A lost wake is noticed and a button pressed.
+
+// What the watch face does and the hardware it runs on.
+struct simstrategy
+{
+  const char *name;
+  simconfig cfg;
+  uint8_t boundary;   // RTC_WAKE_ value for nextMinuteWake.
+  uint32_t syncevery; // Hours between time syncs, 0 only at power up.
+  bool drift;         // Measures the drift from the second sync on.
+  bool internal;      // The drift measured is the ESP32's.
+  uint32_t countdown; // startTimer seconds, started again once it is done.
+};
+
+struct simresult
+{
+  uint64_t wakes;
+  uint64_t early;  // Woke before the boundary with no countdown done.
+  uint64_t missed; // A whole boundary went by without a wake.
+  uint64_t lost;   // Nothing woke it, the button did.
+  uint64_t syncs;
+  double errmax;   // Largest error of the time read (seconds).
+  double errsum;
+  double errend;
+  double lagmax;   // How late after the true boundary the wake came.
+  double lagsum;
+  uint64_t countdowns;
+  double cdlate;   // Latest a countdown was found done (seconds).
+  simbus bus;
+  double charge;   // getTotalCharge (uAh).
+};
+
+// A time server that is always right, reached in 30ms.
+class simsource : public SmallRTCSource
+{
+public:
+  bool
+  sample (int64_t &offset, uint32_t &rtt) override
+  {
+    simAdvance (15000);
+    offset = (int64_t)llround (simTrue () * 1e6) - simRealtimeUs ();
+    simAdvance (15000);
+    rtt = 30000;
+    return true;
+  }
+};
+
+alignas (SmallRTC) static unsigned char _simmem[sizeof (SmallRTC)];
+static SmallRTC *_simrtc = NULL;
+
+// What a reset leaves: RTC memory, nothing else.
+static SmallRTC &
+simBoot ()
+{
+  if (_simrtc)
+    {
+      _simrtc->~SmallRTC ();
+    }
+  _srtcqueue = NULL;
+  _srtcworker = 0;
+  _srtclock = NULL;
+  _srtcowner = NULL;
+  _srtcinterval = 60000;
+  _srtctimerat = 0;
+  _simrtc = new (_simmem) SmallRTC ();
+  return *_simrtc;
+}
+
+static void
+simRun (const simstrategy &s, uint32_t days, simresult &r)
+{
+  simsource src;
+  tmElements_t tm;
+  time_t shown, last = 0;
+  bool due;
+  double t, lag, e, end, synced, cdend = 0;
+  uint32_t period = (s.boundary == RTC_WAKE_HOUR) ? 3600
+                    : (s.boundary == RTC_WAKE_DAY) ? 86400
+                                                   : 60;
+  memset (&r, 0, sizeof (r));
+  simReset (s.cfg);
+  memset (&_ssrtc, 0, sizeof (_ssrtc)); // Power up.
+  SmallRTC &first = simBoot ();
+  first.init ();
+  if (s.internal && first.getType () != RTC_ESP32)
+    {
+      first.useESP32 (true);
+    }
+  first.setWakeBoundary (s.boundary);
+  first.sync (src);
+  r.syncs++;
+  synced = simTrue ();
+  if (s.drift)
+    {
+      first.read (tm);
+      first.beginDrift (tm, s.internal);
+      first.pauseDrift (false);
+    }
+  if (s.countdown)
+    {
+      first.startTimer (s.countdown);
+      cdend = simTrue () + s.countdown;
+    }
+  first.nextMinuteWake ();
+  end = simTrue () + days * 86400.0;
+  while (simTrue () < end)
+    {
+      if (simDeepSleep (SIM_BUTTON) == SIM_WAKE_NONE)
+        {
+          r.lost++;
+        }
+      SmallRTC &rtc = simBoot ();
+      rtc.clearAlarm ();
+      rtc.read (tm);
+      r.wakes++;
+      t = simTrue ();
+      shown = rtc.doMakeTime (tm) / period;
+      due = s.countdown && rtc.timerExpired ();
+      if (last && shown == last && !due)
+        {
+          r.early++;
+        }
+      if (last && shown > last + 1)
+        {
+          r.missed += shown - last - 1;
+        }
+      last = shown;
+      e = fabs ((double)rtc.doMakeTime (tm) - floor (t));
+      r.errmax = fmax (r.errmax, e);
+      r.errsum += e;
+      r.errend = (double)rtc.doMakeTime (tm) - floor (t);
+      lag = fmod (t, period);
+      lag = (lag > period / 2) ? lag - period : lag;
+      r.lagmax = fmax (r.lagmax, lag);
+      r.lagsum += lag;
+      if ((s.syncevery && t - synced >= s.syncevery * 3600.0)
+          || (s.drift && rtc.checkingDrift (s.internal)
+              && t - synced >= 86400.0))
+        {
+          rtc.sync (src);
+          r.syncs++;
+          synced = simTrue ();
+        }
+      if (due)
+        {
+          r.countdowns++;
+          r.cdlate = fmax (r.cdlate, t - cdend);
+          rtc.stopTimer ();
+          rtc.startTimer (s.countdown);
+          cdend = simTrue () + s.countdown;
+        }
+      simAdvance (SIM_AWAKE_US);
+      rtc.nextMinuteWake ();
+    }
+  r.bus = simBus ();
+  r.charge = _simrtc->getTotalCharge ();
+}
+
+int
+main (int argc, char **argv)
+{
+  uint32_t days = (argc > 1) ? (uint32_t)atol (argv[1]) : 30;
+  uint32_t seed = (argc > 2) ? (uint32_t)atol (argv[2]) : 1;
+  simresult r;
+  bool ok = true;
+  // A TCXO, a tuning fork crystal (parabolic around 25C) and the RC.
+  const simosc tcxo = { 1.2, 0, -0.002, 25 };
+  const simosc fork = { 8, 0, -0.034, 25 };
+  const simosc rc = { 0, 300, 0, 25 };
+  const simconfig ds = { SIM_DS3231, tcxo, false, rc, 5, 50, 0,
+                         22, 4, 8, SIM_START, seed };
+  simconfig pcf = ds, s3 = ds, esp = ds, noisy = ds;
+  pcf.chip = SIM_PCF8563;
+  pcf.rtc = fork;
+  s3.chip = SIM_NONE;
+  s3.xtal32k = true;
+  s3.slow = fork;
+  s3.calnoise = 0.5;
+  esp.chip = SIM_NONE;
+  noisy.nack = 0.02;
+  const simstrategy strategies[] = {
+    { "DS3231, minute wakes", ds, RTC_WAKE_MINUTE, 0, false, false },
+    { "DS3231, 2% NACKs", noisy, RTC_WAKE_MINUTE, 0, false, false },
+    { "PCF8563, minute wakes", pcf, RTC_WAKE_MINUTE, 0, false, false },
+    { "PCF8563, hourly wakes", pcf, RTC_WAKE_HOUR, 0, false, false },
+    { "PCF8563, 10m countdown", pcf, RTC_WAKE_HOUR, 0, false, false, 600 },
+    { "DS3231, 90s countdown", ds, RTC_WAKE_MINUTE, 0, false, false, 90 },
+    { "PCF8563, drift measured", pcf, RTC_WAKE_MINUTE, 0, true, false },
+    { "ESP32-S3, 32K crystal", s3, RTC_WAKE_MINUTE, 0, false, true },
+    { "ESP32 RC, daily sync", esp, RTC_WAKE_MINUTE, 24, false, true },
+  };
+  simVerbose (argc > 3 && !strcmp (argv[3], "-v"));
+  printf ("%u days, seed %u\n\n", days, seed);
+  printf ("%-24s %7s %5s %5s %4s %5s %7s %7s %6s %7s %6s %6s %6s %9s %6s "
+          "%7s\n",
+          "strategy", "wakes", "early", "miss", "lost", "syncs", "errmax",
+          "errmean", "errend", "lagmean", "lagmax", "timers", "late", "i2c",
+          "nacks", "mAh");
+  for (const simstrategy &s : strategies)
+    {
+      simRun (s, days, r);
+      printf ("%-24s %7llu %5llu %5llu %4llu %5llu %7.0f %7.2f %6.0f %7.2f "
+              "%6.2f %6llu %6.1f %9llu %6llu %7.2f\n",
+              s.name, (unsigned long long)r.wakes,
+              (unsigned long long)r.early, (unsigned long long)r.missed,
+              (unsigned long long)r.lost, (unsigned long long)r.syncs,
+              r.errmax, r.wakes ? r.errsum / r.wakes : 0, r.errend,
+              r.wakes ? r.lagsum / r.wakes : 0, r.lagmax,
+              (unsigned long long)r.countdowns, r.cdlate,
+              (unsigned long long)r.bus.trans,
+              (unsigned long long)r.bus.nacks, r.charge / 1000.0);
+      // Injected faults can cost wakes, the table says how many.
+      ok = ok && (s.cfg.nack > 0 || (!r.lost && !r.missed));
+    }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+// Host stand-in for the parts of Arduino-ESP32 SmallRTC uses, the behaviour
+// is in simhal.cpp.
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "esp_sleep.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define RTC_DATA_ATTR
+#define _BV(b) (1UL << (b))
+#define log_e(...) simLog ('E', __VA_ARGS__)
+#define log_w(...) simLog ('W', __VA_ARGS__)
+#define log_i(...) simLog ('I', __VA_ARGS__)
+#define log_d(...) simLog ('D', __VA_ARGS__)
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define OUTPUT_OPEN_DRAIN 0x13
+#define LOW 0x0
+#define HIGH 0x1
+
+typedef uint8_t byte;
+static const uint8_t SDA = 21;
+static const uint8_t SCL = 22;
+
+void simLog (char level, const char *format, ...);
+unsigned long millis ();
+void delay (uint32_t ms);
+void delayMicroseconds (uint32_t us);
+uint32_t analogReadMilliVolts (uint8_t pin);
+void pinMode (uint8_t pin, uint8_t mode);
+void digitalWrite (uint8_t pin, uint8_t val);
+int digitalRead (uint8_t pin);
+float temperatureRead ();
+
+class String
+{
+public:
+  String () {}
+  String (const char *s) : _s (s) {}
+  String (const std::string &s) : _s (s) {}
+  int length () const { return (int)_s.size (); }
+  char charAt (int i) const { return _s[i]; }
+  String substring (int from, int to) const
+  {
+    return String (_s.substr (from, to - from));
+  }
+  long toInt () const { return atol (_s.c_str ()); }
+
+private:
+  std::string _s;
+};
+
+class Print
+{
+public:
+  virtual ~Print () {}
+  virtual size_t write (uint8_t c) = 0;
+  size_t printf (const char *format, ...);
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available () = 0;
+  virtual int read () = 0;
+};
+
+class IPAddress
+{
+public:
+  IPAddress () {}
+  IPAddress (uint8_t a, uint8_t b, uint8_t c, uint8_t d) {}
+};
+
+#endif
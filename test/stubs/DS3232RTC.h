@@ -0,0 +1,54 @@
+#ifndef SIM_DS3232RTC_H
+#define SIM_DS3232RTC_H
+
+#include <TimeLib.h>
+
+// The calls SmallRTC makes on JChristensen's DS3232RTC (version 2), done over
+// the simulated Wire the way the library does them.
+class DS3232RTC
+{
+public:
+  enum ALARM_TYPES_t
+  {
+    ALM1_EVERY_SECOND = 0x0F,
+    ALM1_MATCH_SECONDS = 0x0E,
+    ALM1_MATCH_MINUTES = 0x0C,
+    ALM1_MATCH_HOURS = 0x08,
+    ALM1_MATCH_DATE = 0x00,
+    ALM1_MATCH_DAY = 0x10,
+    ALM2_EVERY_MINUTE = 0x8E,
+    ALM2_MATCH_MINUTES = 0x8C,
+    ALM2_MATCH_HOURS = 0x88,
+    ALM2_MATCH_DATE = 0x80,
+    ALM2_MATCH_DAY = 0x90,
+  };
+  enum
+  {
+    ALARM_1 = 1,
+    ALARM_2 = 2
+  };
+  enum SQWAVE_FREQS_t
+  {
+    SQWAVE_1_HZ,
+    SQWAVE_1024_HZ,
+    SQWAVE_4096_HZ,
+    SQWAVE_8192_HZ,
+    SQWAVE_NONE
+  };
+  uint8_t read (tmElements_t &tm);
+  uint8_t write (tmElements_t &tm);
+  uint8_t readRTC (uint8_t addr);
+  uint8_t writeRTC (uint8_t addr, uint8_t value);
+  void setAlarm (ALARM_TYPES_t type, uint8_t seconds, uint8_t minutes,
+                 uint8_t hours, uint8_t daydate);
+  void setAlarm (ALARM_TYPES_t type, uint8_t minutes, uint8_t hours,
+                 uint8_t daydate);
+  void alarmInterrupt (uint8_t alarm, bool enable);
+  bool alarm (uint8_t alarm);
+  void clearAlarm (uint8_t alarm);
+  void squareWave (SQWAVE_FREQS_t freq);
+  int16_t temperature ();
+  bool oscStopped (bool clear = true);
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SIM_RTC_PCF8563_H
+#define SIM_RTC_PCF8563_H
+
+#include <stdint.h>
+
+// The calls SmallRTC makes on the Rtc_Pcf8563 library, done over the
+// simulated Wire the way the library does them.  The year is the raw two
+// digit register, as the library leaves it.
+class Rtc_Pcf8563
+{
+public:
+  void clearStatus ();
+  void setDate (uint8_t day, uint8_t weekday, uint8_t month, uint8_t century,
+                uint8_t year);
+  void setTime (uint8_t hour, uint8_t minute, uint8_t sec);
+  uint8_t getSecond ();
+  uint8_t getMinute ();
+  uint8_t getHour ();
+  uint8_t getDay ();
+  uint8_t getWeekday ();
+  uint8_t getMonth ();
+  uint8_t getYear ();
+  void setAlarm (uint8_t minute, uint8_t hour, uint8_t day, uint8_t weekday);
+  void clearAlarm ();
+  void resetAlarm ();
+
+private:
+  void getDateTime ();
+  uint8_t _regs[7];
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SIM_TIMELIB_H
+#define SIM_TIMELIB_H
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+
+// Same layout and conversions as the Arduino TimeLib.
+typedef struct
+{
+  uint8_t Second;
+  uint8_t Minute;
+  uint8_t Hour;
+  uint8_t Wday; // Day of week, sunday is day 1.
+  uint8_t Day;
+  uint8_t Month;
+  uint8_t Year; // Offset from 1970.
+} tmElements_t;
+
+#define tmYearToCalendar(Y) ((Y) + 1970)
+#define CalendarYrToTm(Y) ((Y) - 1970)
+#define tmYearToY2k(Y) ((Y) - 30)
+#define y2kYearToTm(Y) ((Y) + 30)
+
+time_t makeTime (const tmElements_t &tm);
+void breakTime (time_t t, tmElements_t &tm);
+
+#endif
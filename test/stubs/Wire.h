@@ -0,0 +1,39 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <Arduino.h>
+
+// Talks to the simulated RTC (simhal.cpp) instead of a real bus.
+class TwoWire
+{
+public:
+  bool begin ();
+  bool begin (int sda, int scl, uint32_t frequency = 0);
+  bool end ();
+  bool setClock (uint32_t frequency);
+  uint32_t getClock ();
+  void setTimeOut (uint16_t timeoutms);
+  uint16_t getTimeOut ();
+  void beginTransmission (uint16_t address);
+  uint8_t endTransmission (bool sendstop = true);
+  uint8_t requestFrom (uint8_t address, uint8_t len);
+  size_t write (uint8_t data);
+  size_t write (const uint8_t *data, size_t len);
+  int available ();
+  int read ();
+
+private:
+  uint8_t _addr = 0;
+  uint8_t _tx[32];
+  uint8_t _txlen = 0;
+  uint8_t _rx[32];
+  uint8_t _rxlen = 0;
+  uint8_t _rxpos = 0;
+  uint32_t _clock = 100000;
+  uint16_t _timeout = 50;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef SIM_ESP_CLK_H
+#define SIM_ESP_CLK_H
+
+#include <stdint.h>
+
+uint32_t esp_clk_slowclk_cal_get ();
+uint64_t esp_clk_rtc_time ();
+
+#endif
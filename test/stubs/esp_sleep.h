@@ -0,0 +1,26 @@
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include <stdint.h>
+
+#define ESP_OK 0
+
+typedef int esp_err_t;
+typedef enum
+{
+  GPIO_NUM_0 = 0,
+  GPIO_NUM_27 = 27
+} gpio_num_t;
+typedef enum
+{
+  ESP_SLEEP_WAKEUP_ALL = 0,
+  ESP_SLEEP_WAKEUP_EXT0 = 2,
+  ESP_SLEEP_WAKEUP_TIMER = 4
+} esp_sleep_source_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup (uint64_t us);
+esp_err_t esp_sleep_enable_ext0_wakeup (gpio_num_t pin, int level);
+esp_err_t esp_sleep_disable_wakeup_source (esp_sleep_source_t source);
+esp_err_t esp_light_sleep_start ();
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdint.h>
+
+// Single threaded, the simulator has no tasks.
+typedef void *QueueHandle_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t) (void *);
+typedef struct
+{
+  int count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portMUX_INITIALIZE(m) ((m)->count = 0)
+#define taskENTER_CRITICAL(m) ((void)(m))
+#define taskEXIT_CRITICAL(m) ((void)(m))
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (ms)
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+
+#endif
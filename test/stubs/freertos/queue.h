@@ -0,0 +1,11 @@
+#ifndef SIM_QUEUE_H
+#define SIM_QUEUE_H
+
+#include "FreeRTOS.h"
+
+QueueHandle_t xQueueCreate (uint32_t length, uint32_t size);
+BaseType_t xQueueSend (QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive (QueueHandle_t queue, void *item, TickType_t wait);
+void vQueueDelete (QueueHandle_t queue);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef SIM_SEMPHR_H
+#define SIM_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex ();
+BaseType_t xSemaphoreTakeRecursive (SemaphoreHandle_t mutex, TickType_t wait);
+BaseType_t xSemaphoreGiveRecursive (SemaphoreHandle_t mutex);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef SIM_TASK_H
+#define SIM_TASK_H
+
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreate (TaskFunction_t task, const char *name, uint32_t stack,
+                        void *arg, uint32_t priority, TaskHandle_t *handle);
+void vTaskDelay (TickType_t ticks);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef SIM_SOC_RTC_H
+#define SIM_SOC_RTC_H
+
+#include <stdint.h>
+
+typedef enum
+{
+  RTC_CAL_RTC_MUX = 0
+} rtc_cal_sel_t;
+
+uint32_t rtc_clk_cal (rtc_cal_sel_t sel, uint32_t cycles);
+void rtc_clk_32k_enable (bool enable);
+bool rtc_clk_32k_enabled ();
+
+#endif